@@ -0,0 +1,107 @@
+#include "adjacency.h"
+#include "parallel.h"
+#include <glm/glm/geometric.hpp>
+
+namespace winged {
+
+void Adjacency::build(const Surface &surface, int buildFlags) {
+    flags = buildFlags;
+    size_t numVerts = surface.vertices.size(), numFaces = surface.faces.size();
+
+    // elements already know their index, so every pass over them is parallel
+    vertices.resize(numVerts);
+    faces.resize(numFaces);
+    // count valences, then prefix sum
+    vertOffsets.assign(numVerts + 1, 0);
+    faceOffsets.assign(numFaces + 1, 0);
+    parallelFor(numVerts, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            vertices[i] = surface.vertices[i].get();
+            int count = 0;
+            for (ITER_VERTEX_EDGES(vertices[i], vertEdge))
+                count++;
+            vertOffsets[i + 1] = count;
+        }
+    });
+    parallelFor(numFaces, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            faces[i] = surface.faces[i].get();
+            int count = 0;
+            for (ITER_FACE_EDGES(faces[i], faceEdge))
+                count++;
+            faceOffsets[i + 1] = count;
+        }
+    });
+    for (size_t i = 0; i < numVerts; i++)
+        vertOffsets[i + 1] += vertOffsets[i];
+    for (size_t i = 0; i < numFaces; i++)
+        faceOffsets[i + 1] += faceOffsets[i];
+
+    // fill
+    vertNeighbors.resize(vertOffsets[numVerts]);
+    vertEdges.resize((flags & EDGE_IDS) ? vertNeighbors.size() : 0);
+    opposite.resize((flags & WEIGHTS) ? vertNeighbors.size() * 2 : 0);
+    parallelFor(numVerts, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            int n = vertOffsets[i];
+            for (ITER_VERTEX_EDGES(vertices[i], vertEdge)) {
+                vertNeighbors[n] = (int)vertEdge->twin->vert->index;
+                if (flags & EDGE_IDS)
+                    vertEdges[n] = (int)vertEdge->index;
+                if (flags & WEIGHTS) {
+                    opposite[n * 2] = (int)vertEdge->prev->vert->index;
+                    opposite[n * 2 + 1] = (int)vertEdge->twin->prev->vert->index;
+                }
+                n++;
+            }
+        }
+    });
+    faceNeighbors.resize(faceOffsets[numFaces]);
+    parallelFor(numFaces, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            int n = faceOffsets[i];
+            for (ITER_FACE_EDGES(faces[i], faceEdge))
+                faceNeighbors[n++] = (int)faceEdge->twin->face->index;
+        }
+    });
+
+    vertWeights.resize((flags & WEIGHTS) ? vertNeighbors.size() : 0);
+    updatePositions();
+}
+
+void Adjacency::updatePositions() {
+    positions.resize(vertices.size());
+    parallelFor(vertices.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            positions[i] = vertices[i]->pos;
+    });
+    if (flags & WEIGHTS) {
+        parallelFor(vertices.size(), [&](size_t begin, size_t end) {
+            updateWeights(begin, end);
+        });
+    }
+}
+
+static float cotangent(glm::vec3 apex, glm::vec3 p1, glm::vec3 p2) {
+    glm::vec3 a = p1 - apex, b = p2 - apex;
+    float sin = glm::length(glm::cross(a, b));
+    if (sin < 1e-12f)
+        return 0;
+    return glm::dot(a, b) / sin;
+}
+
+void Adjacency::updateWeights(size_t begin, size_t end) {
+    // for triangles this is the usual cotangent Laplacian. for larger polygons the "opposite"
+    // vertex is the one preceding the edge, which is only an approximation
+    for (size_t i = begin; i < end; i++) {
+        glm::vec3 pi = positions[i];
+        for (int n = vertOffsets[i]; n < vertOffsets[i + 1]; n++) {
+            glm::vec3 pj = positions[vertNeighbors[n]];
+            float w = cotangent(positions[opposite[n * 2]], pi, pj)
+                + cotangent(positions[opposite[n * 2 + 1]], pi, pj);
+            vertWeights[n] = glm::max(w * 0.5f, 0.0f); // clamp obtuse angles to keep solvers stable
+        }
+    }
+}
+
+} // namespace
@@ -0,0 +1,44 @@
+#pragma once
+#include <common.h>
+
+#include "surface.h"
+#include <vector>
+#include <glm/glm/vec3.hpp>
+
+namespace winged {
+
+// flat compressed-sparse-row snapshot of surface connectivity, for numerical solvers.
+// elements are numbered by their position in the Surface vectors at build time.
+struct Adjacency {
+    enum Flags {
+        EDGE_IDS = 1,
+        WEIGHTS = 2,
+    };
+
+    std::vector<Vertex *> vertices;
+    std::vector<Face *> faces;
+    std::vector<glm::vec3> positions;
+
+    // neighbors of vertex i are vertNeighbors[vertOffsets[i]] to vertNeighbors[vertOffsets[i+1]-1]
+    std::vector<int> vertOffsets, vertNeighbors;
+    std::vector<int> vertEdges; // outgoing edge index for each neighbor (EDGE_IDS)
+    std::vector<float> vertWeights; // cotangent weight for each neighbor (WEIGHTS)
+    // faces across each edge of face i, in edge order
+    std::vector<int> faceOffsets, faceNeighbors;
+
+    void build(const Surface &surface, int flags = 0); // O(n)
+    // refresh positions and weights after vertices moved. topology must not have changed!
+    void updatePositions(); // O(n)
+
+    int numVertices() const { return (int)vertices.size(); }
+    int numFaces() const { return (int)faces.size(); }
+
+private:
+    int flags = 0;
+    // vertex opposite each neighbor edge on the left and right face (WEIGHTS)
+    std::vector<int> opposite;
+
+    void updateWeights(size_t begin, size_t end);
+};
+
+} // namespace
@@ -0,0 +1,422 @@
+// headless batch processing of mesh files, for running on servers without a window
+// usage: batch [-j threads] script files...
+// script is a list of operations separated by spaces or commas, each optionally followed by
+// :argument, eg. "validate weld:0.001 simplify:0.5 triangulate export:out"
+// or: batch replay logs...
+// to replay editor sessions recorded with --record, with timing and allocation counts for each
+// operation
+// build (from the repository root, with the glm submodule checked out):
+// cmake -S . -B build && cmake --build build
+
+#include "surface.h"
+#include "operations.h"
+#include "boolean.h"
+#include "hull.h"
+#include "memusage.h"
+#include "modifiers.h"
+#include "objfile.h"
+#include "oplog.h"
+#include "parallel.h"
+#include "simplify.h"
+#include "weld.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <clocale>
+#include <cstdio>
+#include <cstdlib>
+#include <cwchar>
+#include <filesystem>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace winged;
+using Clock = std::chrono::steady_clock;
+
+struct Operation {
+    enum Type {
+        VALIDATE,
+        WELD, // argument: tolerance
+        SIMPLIFY, // argument: ratio of vertices to keep
+        SUBDIVIDE, // argument: levels
+        MIRROR, // argument: axis, 0-2
+        ARRAY, // argument: count, copies side by side along x
+        SOLIDIFY, // argument: thickness
+        TRIANGULATE,
+        HULL, // replace with the convex hull, eg. for collision shapes
+        UNION, // argument: obj file of the other solid
+        INTERSECT, // argument: obj file
+        SUBTRACT, // argument: obj file to cut away
+        MEMORY, // argument: budget in megabytes, fails if the surface uses more (0 for none)
+        EXPORT // argument: output directory, file keeps its name
+    };
+    Type type;
+    float amount;
+    std::string path;
+};
+
+static const struct {
+    const char *name;
+    Operation::Type type;
+    float defaultAmount;
+} OPERATION_NAMES[] = {
+    {"validate", Operation::VALIDATE, 0},
+    {"weld", Operation::WELD, 1e-4f},
+    {"simplify", Operation::SIMPLIFY, 0.5f},
+    {"subdivide", Operation::SUBDIVIDE, 1},
+    {"mirror", Operation::MIRROR, 0},
+    {"array", Operation::ARRAY, 2},
+    {"solidify", Operation::SOLIDIFY, 0.1f},
+    {"triangulate", Operation::TRIANGULATE, 0},
+    {"hull", Operation::HULL, 0},
+    {"union", Operation::UNION, 0},
+    {"intersect", Operation::INTERSECT, 0},
+    {"subtract", Operation::SUBTRACT, 0},
+    {"memory", Operation::MEMORY, 0},
+    {"export", Operation::EXPORT, 0},
+};
+
+static std::mutex printMutex;
+
+static std::wstring widen(const std::string &str) {
+    std::wstring wide(str.size(), L'\0');
+    size_t length = mbstowcs(&wide[0], str.c_str(), str.size());
+    if (length == (size_t)-1)
+        return std::wstring(str.begin(), str.end());
+    wide.resize(length);
+    return wide;
+}
+
+static bool parseScript(const std::string &script, std::vector<Operation> *operations) {
+    size_t pos = 0;
+    while (pos < script.size()) {
+        size_t end = script.find_first_of(" ,", pos);
+        if (end == std::string::npos)
+            end = script.size();
+        std::string token = script.substr(pos, end - pos);
+        pos = end + 1;
+        if (token.empty())
+            continue;
+
+        std::string name = token, arg;
+        size_t colon = token.find(':');
+        if (colon != std::string::npos) {
+            name = token.substr(0, colon);
+            arg = token.substr(colon + 1);
+        }
+        bool found = false;
+        for (auto &opName : OPERATION_NAMES) {
+            if (name != opName.name)
+                continue;
+            Operation op;
+            op.type = opName.type;
+            op.amount = arg.empty() ? opName.defaultAmount : strtof(arg.c_str(), nullptr);
+            op.path = arg;
+            if (op.type == Operation::EXPORT && arg.empty()) {
+                wprintf(L"export needs an output directory!\n");
+                return false;
+            }
+            if ((op.type == Operation::UNION || op.type == Operation::INTERSECT
+                    || op.type == Operation::SUBTRACT) && arg.empty()) {
+                wprintf(L"%ls needs an obj file!\n", widen(name).c_str());
+                return false;
+            }
+            operations->push_back(op);
+            found = true;
+        }
+        if (!found) {
+            wprintf(L"Unknown operation: %ls\n", widen(name).c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+// replace surface with the output of a stack holding just this modifier
+static void applyModifier(Surface *surface, std::unique_ptr<Modifier> modifier) {
+    ModifierStack stack;
+    stack.add(std::move(modifier));
+    const Surface &result = stack.evaluate(*surface);
+    Surface output;
+    copySurface(&output, result);
+    *surface = std::move(output);
+}
+
+static bool runOperation(Surface *surface, const Operation &op, const std::string &file) {
+    switch (op.type) {
+        case Operation::VALIDATE:
+            return validateSurface(surface);
+        case Operation::WELD:
+            weldVertices(surface, op.amount);
+            return true;
+        case Operation::SIMPLIFY:
+            simplifySurface(surface, op.amount);
+            return true;
+        case Operation::SUBDIVIDE: {
+            auto subdivide = std::make_unique<SubdivideModifier>();
+            subdivide->levels = (int)op.amount;
+            applyModifier(surface, std::move(subdivide));
+            return true;
+        }
+        case Operation::MIRROR: {
+            int axis = (int)op.amount;
+            if (axis < 0 || axis > 2) {
+                wprintf(L"Mirror axis must be 0, 1 or 2!\n");
+                return false;
+            }
+            auto mirror = std::make_unique<MirrorModifier>();
+            mirror->axis = axis;
+            applyModifier(surface, std::move(mirror));
+            return true;
+        }
+        case Operation::ARRAY: {
+            float minX = 0, maxX = 0;
+            for (auto &vert : surface->vertices) {
+                minX = std::min(minX, vert->pos.x);
+                maxX = std::max(maxX, vert->pos.x);
+            }
+            auto array = std::make_unique<ArrayModifier>();
+            array->count = std::max(1, (int)op.amount);
+            array->offset = glm::vec3(maxX - minX, 0, 0);
+            applyModifier(surface, std::move(array));
+            return true;
+        }
+        case Operation::SOLIDIFY: {
+            auto solidify = std::make_unique<SolidifyModifier>();
+            solidify->thickness = op.amount;
+            applyModifier(surface, std::move(solidify));
+            return true;
+        }
+        case Operation::TRIANGULATE: {
+            // new faces are added at the end and are already triangles
+            size_t numFaces = surface->faces.size();
+            for (size_t i = 0; i < numFaces; i++) {
+                if (!triangulateFace(surface, surface->faces[i].get()))
+                    return false;
+            }
+            return true;
+        }
+        case Operation::HULL: {
+            std::vector<glm::vec3> points;
+            points.reserve(surface->vertices.size());
+            for (auto &vert : surface->vertices)
+                points.push_back(vert->pos);
+            Surface hull;
+            if (!convexHull(&hull, points))
+                return false;
+            *surface = std::move(hull);
+            return true;
+        }
+        case Operation::UNION:
+        case Operation::INTERSECT:
+        case Operation::SUBTRACT: {
+            // loaded again for each file, so workers don't share it
+            Surface other;
+            if (!readObj(&other, op.path.c_str()))
+                return false;
+            BooleanOp booleanOp = op.type == Operation::UNION ? BOOLEAN_UNION
+                : op.type == Operation::INTERSECT ? BOOLEAN_INTERSECTION : BOOLEAN_DIFFERENCE;
+            return booleanSurfaces(surface, *surface, other, booleanOp);
+        }
+        case Operation::MEMORY: {
+            MemoryUsage usage;
+            addSurfaceMemory(*surface, &usage);
+            double megabytes = usage.total() / (1024.0 * 1024.0);
+            if (op.amount > 0 && megabytes > op.amount) {
+                wprintf(L"Surface uses %.1f MB, over the budget of %.1f MB!\n", megabytes,
+                    op.amount);
+                return false;
+            }
+            return true;
+        }
+        case Operation::EXPORT: {
+            std::filesystem::path out = std::filesystem::path(op.path)
+                / std::filesystem::path(file).filename();
+            return writeObj(*surface, out.string().c_str());
+        }
+    }
+    return false;
+}
+
+struct FileResult {
+    bool ok = false;
+    size_t inFaces = 0;
+};
+
+static FileResult processFile(const std::string &file, const std::vector<Operation> &operations) {
+    FileResult result;
+    std::wstring report = widen(file) + L":";
+    wchar_t buf[256];
+    Clock::time_point start = Clock::now(), opStart = start;
+    auto elapsedMs = [](Clock::time_point since) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+    };
+
+    Surface surface;
+    result.ok = readObj(&surface, file.c_str());
+    if (result.ok) {
+        result.inFaces = surface.faces.size();
+        swprintf(buf, 256, L" %zu verts %zu faces, load %.1f ms", surface.vertices.size(),
+            surface.faces.size(), elapsedMs(opStart));
+        report += buf;
+        for (auto &op : operations) {
+            opStart = Clock::now();
+            AllocationCounter allocations;
+            result.ok = runOperation(&surface, op, file);
+            swprintf(buf, 256, L", %ls %.1f ms %zu allocs",
+                widen(OPERATION_NAMES[op.type].name).c_str(), elapsedMs(opStart),
+                allocations.count());
+            report += buf;
+            if (op.type == Operation::MEMORY) {
+                MemoryUsage usage;
+                addSurfaceMemory(surface, &usage);
+                swprintf(buf, 256, L" %.1f MB", usage.total() / (1024.0 * 1024.0));
+                report += buf;
+            }
+            if (!result.ok)
+                break;
+        }
+    }
+    if (result.ok) {
+        swprintf(buf, 256, L" -> %zu verts %zu faces, total %.1f ms", surface.vertices.size(),
+            surface.faces.size(), elapsedMs(start));
+    } else {
+        swprintf(buf, 256, L" FAILED after %.1f ms", elapsedMs(start));
+    }
+    report += buf;
+
+    std::lock_guard<std::mutex> lock(printMutex);
+    wprintf(L"%ls\n", report.c_str());
+    return result;
+}
+
+// hash of the final state, to check that replays are deterministic
+static uint64_t surfaceChecksum(const Surface &surface) {
+    uint64_t hash = 14695981039346656037ull; // FNV-1a
+    auto add = [&](const void *data, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            hash ^= ((const uint8_t *)data)[i];
+            hash *= 1099511628211ull;
+        }
+    };
+    for (auto &vert : surface.vertices) {
+        add(&vert->id, sizeof(vert->id));
+        add(&vert->pos, sizeof(vert->pos));
+    }
+    for (auto &edge : surface.edges) {
+        add(&edge->id, sizeof(edge->id));
+        add(&edge->vert->id, sizeof(edge->vert->id));
+        add(&edge->face->id, sizeof(edge->face->id));
+    }
+    return hash;
+}
+
+static int replayMain(int numLogs, char **logs) {
+    int failed = 0;
+    for (int i = 0; i < numLogs; i++) {
+        Surface surface;
+        ReplayTiming timing;
+        bool ok = replayLog(logs[i], &surface, &timing);
+        wprintf(L"%ls: %zu operations%ls\n", widen(logs[i]).c_str(), timing.ops.size(),
+            ok ? L"" : L", FAILED");
+        if (!ok || !validateSurface(&surface)) {
+            failed++;
+            continue;
+        }
+
+        int count[OpLog::NUM_OPS] = {};
+        double total[OpLog::NUM_OPS] = {}, slowest[OpLog::NUM_OPS] = {}, sum = 0;
+        size_t allocations[OpLog::NUM_OPS] = {}, allocatedBytes[OpLog::NUM_OPS] = {};
+        size_t slowestIndex = 0;
+        for (size_t j = 0; j < timing.ops.size(); j++) {
+            auto &entry = timing.ops[j];
+            count[entry.op]++;
+            total[entry.op] += entry.seconds;
+            slowest[entry.op] = std::max(slowest[entry.op], entry.seconds);
+            allocations[entry.op] += entry.allocations;
+            allocatedBytes[entry.op] += entry.allocatedBytes;
+            if (entry.seconds > timing.ops[slowestIndex].seconds)
+                slowestIndex = j;
+            sum += entry.seconds;
+        }
+        for (int op = 0; op < OpLog::NUM_OPS; op++) {
+            if (count[op]) {
+                wprintf(L"  %-14ls %6d ops, total %9.2f ms, mean %8.3f ms, max %8.3f ms, "
+                    L"mean %7.1f allocs %9.0f bytes\n",
+                    OpLog::OP_NAMES[op], count[op], total[op] * 1000,
+                    total[op] * 1000 / count[op], slowest[op] * 1000,
+                    (double)allocations[op] / count[op], (double)allocatedBytes[op] / count[op]);
+            }
+        }
+        if (!timing.ops.empty()) {
+            wprintf(L"  slowest: #%zu %ls %.3f ms\n", slowestIndex,
+                OpLog::OP_NAMES[timing.ops[slowestIndex].op],
+                timing.ops[slowestIndex].seconds * 1000);
+        }
+        wprintf(L"  total %.2f ms -> %zu verts %zu faces, checksum %016llx\n", sum * 1000,
+            surface.vertices.size(), surface.faces.size(),
+            (unsigned long long)surfaceChecksum(surface));
+    }
+    return failed ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    setlocale(LC_CTYPE, ""); // for wide output only, numbers must keep using "."
+    if (argc >= 2 && strcmp(argv[1], "replay") == 0)
+        return replayMain(argc - 2, argv + 2);
+    int numThreads = (int)std::max(1u, std::thread::hardware_concurrency());
+    int arg = 1;
+    if (arg + 1 < argc && std::string(argv[arg]) == "-j") {
+        numThreads = std::max(1, atoi(argv[arg + 1]));
+        arg += 2;
+    }
+    if (argc - arg < 2) {
+        wprintf(L"usage: batch [-j threads] script files...\n"
+            L"       batch replay logs...\n"
+            L"operations: validate weld[:tolerance] simplify[:ratio] subdivide[:levels] "
+            L"mirror[:axis] array[:count] solidify[:thickness] triangulate hull union:file "
+            L"intersect:file subtract:file memory[:megabytes] export:directory\n");
+        return 2;
+    }
+    std::vector<Operation> operations;
+    if (!parseScript(argv[arg++], &operations))
+        return 2;
+    std::vector<std::string> files(argv + arg, argv + argc);
+    for (auto &op : operations) {
+        if (op.type == Operation::EXPORT) {
+            std::error_code error;
+            std::filesystem::create_directories(op.path, error);
+        }
+    }
+
+    // each worker holds one surface at a time, which bounds memory use to numThreads surfaces.
+    // with a single worker the operations themselves may use every core instead
+    numThreads = std::min(numThreads, (int)files.size());
+    std::atomic<size_t> nextFile {0}, failed {0}, totalFaces {0};
+    auto worker = [&]() {
+        parallelSerial = numThreads > 1;
+        size_t i;
+        while ((i = nextFile++) < files.size()) {
+            FileResult result = processFile(files[i], operations);
+            if (!result.ok)
+                failed++;
+            totalFaces += result.inFaces;
+        }
+    };
+    Clock::time_point start = Clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 1; t < numThreads; t++)
+        threads.emplace_back(worker);
+    worker();
+    for (auto &thread : threads)
+        thread.join();
+
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    wprintf(L"%zu files, %zu failed, %.2f s on %d threads: %.1f files/s, %.0f faces/s\n",
+        files.size(), failed.load(), seconds, numThreads, files.size() / seconds,
+        totalFaces.load() / seconds);
+    return failed ? 1 : 0;
+}
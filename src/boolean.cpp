@@ -0,0 +1,1284 @@
+#include "boolean.h"
+#include "bvh.h"
+#include "operations.h"
+#include "parallel.h"
+#include "polygon.h"
+#include "predicates.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cwchar>
+#include <mutex>
+#include <numeric>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <glm/glm/geometric.hpp>
+
+namespace winged {
+
+namespace {
+
+// defined by three exact points, so tests against it are exact
+struct Plane {
+    glm::dvec3 p[3];
+
+    double side(glm::dvec3 point) const { return orient3d(p[0], p[1], p[2], point); }
+    glm::dvec3 normal() const { return glm::cross(p[1] - p[0], p[2] - p[0]); }
+};
+
+// how a point was constructed. its position only depends on this, so the same point made from
+// either side comes out exactly the same
+struct Key {
+    enum Kind { ORIGINAL, PLANES, EDGE_PLANE } kind;
+    // ORIGINAL: side, vertex. PLANES: three planes, sorted.
+    // EDGE_PLANE: side, the vertices of an edge (sorted), plane
+    int a, b, c, d;
+};
+
+struct Point {
+    Key key;
+    glm::dvec3 pos;
+};
+
+// where two planes meet (kind 0, planes a < b), or through an edge between vertices a < b of
+// one side (kind 1 + side). an edge is its own line unless its regions meet along other edges
+// too
+struct Line {
+    int kind, a, b;
+
+    bool operator==(const Line &other) const {
+        return kind == other.kind && a == other.a && b == other.b;
+    }
+};
+
+struct LineHash {
+    size_t operator()(const Line &line) const {
+        uint64_t h = ((uint64_t)(uint32_t)line.a << 32 | (uint32_t)line.b)
+            * 0x9E3779B97F4A7C15ull;
+        return (size_t)(h ^ (h >> 29)) + line.kind;
+    }
+};
+
+// convex piece of a triangle
+struct Fragment {
+    std::vector<Point> points;
+    std::vector<Line> lines; // lines[i] contains the edge from points[i] to the next point
+    int coplanar = 0; // on a face of the other side facing the same way (1) or opposite (-1)
+    bool keep = false;
+    std::vector<int> verts; // output vertices of the points, once kept
+};
+
+// found exactly on a cutting plane: points which lie on the cut line, and edges along it which
+// are known by another line
+struct Contacts {
+    std::vector<std::pair<Point, Line>> points;
+    std::vector<std::pair<Line, Line>> lines;
+};
+
+struct Triangle {
+    int v[3];
+    int region; // plane, shared by connected triangles which are exactly coplanar
+    int neighbor[3]; // across the edge from v[i] to v[i + 1]
+    int edge[3]; // HEdge index of that edge, -1 for a diagonal inside the face
+};
+
+struct Candidate {
+    int tri; // on the other side
+    bool coplanar;
+};
+
+struct EdgePlane {
+    int side, lo, hi, region, plane;
+};
+
+// edge between two regions a < b of one side
+struct RegionEdge {
+    int a, b, side, lo, hi;
+};
+
+struct Side {
+    const Surface *surface;
+    std::vector<glm::dvec3> positions; // by vertex index
+    std::vector<int> faceStart; // triangles of face i are faceStart[i] up to faceStart[i + 1]
+    std::vector<Triangle> triangles;
+    std::vector<int> edgeTriangle; // by HEdge index, triangle * 3 + edge
+    std::vector<char> degenerate;
+    std::vector<Bounds> bounds; // by triangle
+    Bounds total;
+    BVH bvh;
+
+    // triangles which cross the other side, with the triangles they may cross
+    std::vector<int> cut, cutIndex; // cutIndex by triangle, -1 if not cut
+    std::vector<int> candidateStart;
+    std::vector<Candidate> candidates;
+    std::vector<std::vector<Fragment>> fragments; // by cut index
+    std::vector<Contacts> contacts; // by cut index
+    std::vector<char> keepTriangle; // for triangles which aren't cut
+};
+
+int findRoot(std::vector<int> &parent, int i) {
+    while (parent[i] != i)
+        i = parent[i] = parent[parent[i]];
+    return i;
+}
+
+bool collinear(glm::dvec3 a, glm::dvec3 b, glm::dvec3 c) {
+    return orient2d(glm::dvec2(a.x, a.y), glm::dvec2(b.x, b.y), glm::dvec2(c.x, c.y)) == 0
+        && orient2d(glm::dvec2(a.y, a.z), glm::dvec2(b.y, b.z), glm::dvec2(c.y, c.z)) == 0
+        && orient2d(glm::dvec2(a.z, a.x), glm::dvec2(b.z, b.x), glm::dvec2(c.z, c.x)) == 0;
+}
+
+Line planeLine(int p, int q) {
+    return {0, std::min(p, q), std::max(p, q)};
+}
+
+// conservative, padded for rounding in the slab test
+bool segmentHitsBox(glm::dvec3 from, glm::dvec3 to, const Bounds &box) {
+    double t0 = 0, t1 = 1;
+    for (int i = 0; i < 3; i++) {
+        double pad = 1e-9 * (std::abs((double)box.min[i]) + std::abs((double)box.max[i]))
+            + 1e-30;
+        double lo = box.min[i] - pad, hi = box.max[i] + pad, d = to[i] - from[i];
+        if (d == 0) {
+            if (from[i] < lo || from[i] > hi)
+                return false;
+            continue;
+        }
+        double a = (lo - from[i]) / d, b = (hi - from[i]) / d;
+        if (a > b)
+            std::swap(a, b);
+        t0 = std::max(t0, a);
+        t1 = std::min(t1, b);
+        if (t0 > t1)
+            return false;
+    }
+    return true;
+}
+
+const int CROSS_DEGENERATE = 2;
+
+// +1 if the segment leaves the solid through the triangle, -1 if it enters, 0 if it misses.
+// CROSS_DEGENERATE if it touches an edge, a vertex or starts on the triangle
+int crossSegment(glm::dvec3 from, glm::dvec3 to, glm::dvec3 a, glm::dvec3 b, glm::dvec3 c) {
+    double s1 = orient3d(a, b, c, from), s2 = orient3d(a, b, c, to);
+    if ((s1 > 0 && s2 > 0) || (s1 < 0 && s2 < 0))
+        return 0;
+    double e1 = orient3d(from, to, a, b), e2 = orient3d(from, to, b, c),
+        e3 = orient3d(from, to, c, a);
+    if ((e1 > 0 || e2 > 0 || e3 > 0) && (e1 < 0 || e2 < 0 || e3 < 0))
+        return 0;
+    if (s1 == 0 || s2 == 0 || e1 == 0 || e2 == 0 || e3 == 0)
+        return CROSS_DEGENERATE;
+    return s1 < 0 ? 1 : -1;
+}
+
+// points within a distance of each other
+struct PointGrid {
+    double cell;
+    std::unordered_map<uint64_t, std::vector<int>> cells;
+
+    static uint64_t key(glm::dvec3 c) {
+        return (uint64_t)(int64_t)c.x * 0x9E3779B97F4A7C15ull
+            ^ (uint64_t)(int64_t)c.y * 0xC2B2AE3D27D4EB4Full
+            ^ (uint64_t)(int64_t)c.z * 0x165667B19E3779F9ull;
+    }
+    glm::dvec3 cellOf(glm::dvec3 pos) const {
+        return glm::dvec3(std::floor(pos.x / cell), std::floor(pos.y / cell),
+            std::floor(pos.z / cell));
+    }
+    // a point already added which is within a cell of pos, or -1
+    int near(const std::vector<glm::dvec3> &points, glm::dvec3 pos) const {
+        glm::dvec3 c = cellOf(pos);
+        for (int x = -1; x <= 1; x++) {
+            for (int y = -1; y <= 1; y++) {
+                for (int z = -1; z <= 1; z++) {
+                    auto it = cells.find(key(c + glm::dvec3(x, y, z)));
+                    if (it == cells.end())
+                        continue;
+                    for (int other : it->second) {
+                        if (glm::distance(points[other], pos) <= cell)
+                            return other;
+                    }
+                }
+            }
+        }
+        return -1;
+    }
+    // a point already added which is within a cell of pos, otherwise adds index
+    int find(const std::vector<glm::dvec3> &points, glm::dvec3 pos, int index) {
+        int other = near(points, pos);
+        if (other >= 0)
+            return other;
+        cells[key(cellOf(pos))].push_back(index);
+        return index;
+    }
+};
+
+class Boolean {
+public:
+    Boolean(BooleanOp op) : op(op) {}
+
+    void prepare(int s, const Surface &surface);
+    void findCandidates();
+    void findRegionEdges();
+    void addEdgePlanes();
+    void splitTriangles(int s);
+    void classify(int s);
+    bool build(Surface *result);
+
+    Side sides[2];
+
+private:
+    BooleanOp op;
+    std::vector<Plane> planes; // regions of both sides, then edge planes
+    std::vector<EdgePlane> edgePlanes; // sorted
+    struct Region {
+        int count = 0, side, tri; // the triangle, if there's only one
+    };
+    std::vector<Region> regions; // by plane
+    std::vector<RegionEdge> regionEdges; // sorted, only where a region has several triangles
+
+    // output, built up by build()
+    std::vector<glm::dvec3> exact; // by output vertex
+    std::unordered_map<Line, std::vector<std::pair<double, int>>, LineHash> linePoints;
+    // lines found to be the same as another one, which linePoints is keyed by
+    std::unordered_map<Line, Line, LineHash> sameLine;
+
+    bool sharedEdge(int p, int q, int *s, int *lo, int *hi) const;
+    Line regionLine(int p, int q) const;
+    Line edgeLine(int s, int t, int k) const;
+    int edgePlane(int s, int lo, int hi, int region) const;
+    double side(const Point &point, int plane) const;
+    bool onPlane(const Line &line, int plane) const;
+    bool planesPoint(const int ids[3], glm::dvec3 *pos) const;
+    Point intersect(const Line &line, int plane, const Point &from, const Point &to) const;
+    int split(const Fragment &frag, int plane, const Line &cut, Fragment *front,
+        Fragment *back, Contacts *contacts) const;
+    void clipCoplanar(int s, int t, const Candidate &candidate,
+        std::vector<Fragment> *fragments, Contacts *contacts) const;
+    bool winding(int s, glm::dvec3 point, glm::dvec3 dir, int *number) const;
+    bool inside(int s, glm::dvec3 point, bool *result) const;
+    bool keep(int s, bool inside, int coplanar) const;
+    Line lineKey(const Line &line) const;
+    void joinLines(const Line &a, const Line &b);
+    glm::dvec3 lineDirection(const Line &line) const;
+    void appendEdge(std::vector<int> *verts, const Line &line, int from, int to) const;
+};
+
+} // namespace
+
+void Boolean::prepare(int s, const Surface &surface) {
+    Side &side = sides[s];
+    side.surface = &surface;
+    side.positions.resize(surface.vertices.size());
+    for (auto &vert : surface.vertices)
+        side.positions[vert->index] = vert->pos;
+    size_t numFaces = surface.faces.size();
+    side.faceStart.resize(numFaces + 1);
+    side.faceStart[0] = 0;
+    for (size_t f = 0; f < numFaces; f++) {
+        int n = 0;
+        for (ITER_FACE_EDGES(surface.faces[f].get(), edge))
+            n++;
+        side.faceStart[f + 1] = side.faceStart[f] + std::max(n - 2, 0);
+    }
+    int numTris = side.faceStart[numFaces];
+    side.triangles.resize(numTris);
+    side.edgeTriangle.assign(surface.edges.size(), -1);
+
+    parallelFor(numFaces, [&](size_t begin, size_t end) {
+        std::vector<HEdge *> edges;
+        std::vector<glm::dvec2> points;
+        std::vector<int> local;
+        for (size_t f = begin; f < end; f++) {
+            Face *face = surface.faces[f].get();
+            edges.clear();
+            for (ITER_FACE_EDGES(face, edge))
+                edges.push_back(edge);
+            int n = (int)edges.size(), first = side.faceStart[f];
+            local.clear();
+            if (n == 3) {
+                local.insert(local.end(), {0, 1, 2});
+            } else {
+                projectFace(face, &points);
+                triangulatePolygon(points, &local);
+            }
+            for (int i = 0; i < n - 2; i++) {
+                Triangle &tri = side.triangles[first + i];
+                for (int k = 0; k < 3; k++) {
+                    int from = local[i * 3 + k], to = local[i * 3 + (k + 1) % 3];
+                    tri.v[k] = (int)edges[from]->vert->index;
+                    tri.neighbor[k] = -1;
+                    tri.edge[k] = -1;
+                    if (to == (from + 1) % n) {
+                        tri.edge[k] = (int)edges[from]->index;
+                        side.edgeTriangle[tri.edge[k]] = (first + i) * 3 + k;
+                    }
+                }
+            }
+            // diagonals are shared by two triangles of the face
+            for (int i = 0; i < n - 2; i++) {
+                for (int k = 0; k < 3; k++) {
+                    Triangle &tri = side.triangles[first + i];
+                    if (tri.edge[k] >= 0 || tri.neighbor[k] >= 0)
+                        continue;
+                    int from = local[i * 3 + k], to = local[i * 3 + (k + 1) % 3];
+                    for (int j = i + 1; j < n - 2 && tri.neighbor[k] < 0; j++) {
+                        for (int l = 0; l < 3; l++) {
+                            if (local[j * 3 + l] == to && local[j * 3 + (l + 1) % 3] == from) {
+                                tri.neighbor[k] = first + j;
+                                side.triangles[first + j].neighbor[l] = first + i;
+                                break;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }, 1024);
+
+    side.bounds.resize(numTris);
+    side.degenerate.resize(numTris);
+    std::vector<char> flatEdge(numTris * 3, 0); // neighbor is in the same plane
+    parallelFor(numTris, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; t++) {
+            Triangle &tri = side.triangles[t];
+            for (int k = 0; k < 3; k++) {
+                if (tri.edge[k] >= 0) {
+                    HEdge *twin = surface.edges[tri.edge[k]]->twin;
+                    tri.neighbor[k] = side.edgeTriangle[twin->index] / 3;
+                }
+            }
+            glm::dvec3 p0 = side.positions[tri.v[0]], p1 = side.positions[tri.v[1]],
+                p2 = side.positions[tri.v[2]];
+            Bounds &bounds = side.bounds[t];
+            bounds = Bounds();
+            bounds.extend(glm::vec3(p0));
+            bounds.extend(glm::vec3(p1));
+            bounds.extend(glm::vec3(p2));
+            side.degenerate[t] = collinear(p0, p1, p2);
+        }
+    });
+    for (const Bounds &bounds : side.bounds)
+        side.total.extend(bounds);
+    parallelFor(numTris, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; t++) {
+            const Triangle &tri = side.triangles[t];
+            glm::dvec3 p0 = side.positions[tri.v[0]], p1 = side.positions[tri.v[1]],
+                p2 = side.positions[tri.v[2]];
+            for (int k = 0; k < 3; k++) {
+                int n = tri.neighbor[k];
+                if (n < (int)t || side.degenerate[t] || side.degenerate[n])
+                    continue;
+                for (int v : side.triangles[n].v) {
+                    if (v == tri.v[k] || v == tri.v[(k + 1) % 3])
+                        continue;
+                    flatEdge[t * 3 + k] = orient3d(p0, p1, p2, side.positions[v]) == 0;
+                    break;
+                }
+            }
+        }
+    });
+
+    std::vector<int> parent(numTris);
+    std::iota(parent.begin(), parent.end(), 0);
+    for (int t = 0; t < numTris; t++) {
+        for (int k = 0; k < 3; k++) {
+            if (flatEdge[t * 3 + k])
+                parent[findRoot(parent, side.triangles[t].neighbor[k])] = findRoot(parent, t);
+        }
+    }
+    std::vector<int> regionOf(numTris, -1);
+    for (int t = 0; t < numTris; t++) {
+        int root = findRoot(parent, t);
+        if (regionOf[root] < 0) {
+            regionOf[root] = (int)planes.size();
+            const Triangle &tri = side.triangles[root];
+            planes.push_back({{side.positions[tri.v[0]], side.positions[tri.v[1]],
+                side.positions[tri.v[2]]}});
+        }
+        side.triangles[t].region = regionOf[root];
+    }
+}
+
+void Boolean::findCandidates() {
+    struct Pair {
+        int tri[2];
+        bool coplanar;
+    };
+    const Side &a = sides[0], &b = sides[1];
+    std::vector<Pair> pairs;
+    std::mutex mutex;
+    parallelFor(a.triangles.size(), [&](size_t begin, size_t end) {
+        std::vector<Pair> found;
+        for (int t = (int)begin; t < (int)end; t++) {
+            if (a.degenerate[t] || !a.bounds[t].overlaps(b.total))
+                continue;
+            const Triangle &ta = a.triangles[t];
+            glm::dvec3 pa[3] = {a.positions[ta.v[0]], a.positions[ta.v[1]],
+                a.positions[ta.v[2]]};
+            b.bvh.query(a.bounds[t], [&](int s) {
+                if (b.degenerate[s])
+                    return;
+                const Triangle &tb = b.triangles[s];
+                glm::dvec3 pb[3] = {b.positions[tb.v[0]], b.positions[tb.v[1]],
+                    b.positions[tb.v[2]]};
+                // both have to reach the plane of the other. touching counts
+                int above = 0, below = 0;
+                for (glm::dvec3 p : pb) {
+                    double d = orient3d(pa[0], pa[1], pa[2], p);
+                    above += d > 0;
+                    below += d < 0;
+                }
+                if (above == 3 || below == 3)
+                    return;
+                if (above == 0 && below == 0) {
+                    found.push_back({{t, s}, true});
+                    return;
+                }
+                above = below = 0;
+                for (glm::dvec3 p : pa) {
+                    double d = orient3d(pb[0], pb[1], pb[2], p);
+                    above += d > 0;
+                    below += d < 0;
+                }
+                if (above != 3 && below != 3)
+                    found.push_back({{t, s}, false});
+            });
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        pairs.insert(pairs.end(), found.begin(), found.end());
+    }, 1024);
+
+    for (int s = 0; s < 2; s++) {
+        std::sort(pairs.begin(), pairs.end(), [&](const Pair &p, const Pair &q) {
+            return std::tie(p.tri[s], p.tri[1 - s]) < std::tie(q.tri[s], q.tri[1 - s]);
+        });
+        Side &side = sides[s];
+        side.cutIndex.assign(side.triangles.size(), -1);
+        for (const Pair &pair : pairs) {
+            int t = pair.tri[s];
+            if (side.cutIndex[t] < 0) {
+                side.cutIndex[t] = (int)side.cut.size();
+                side.cut.push_back(t);
+                side.candidateStart.push_back((int)side.candidates.size());
+            }
+            side.candidates.push_back({pair.tri[1 - s], pair.coplanar});
+        }
+        side.candidateStart.push_back((int)side.candidates.size());
+    }
+
+    // coplanar regions of the two sides share one plane, so lines and points along it are
+    // identified the same way from either side
+    std::vector<int> parent(planes.size());
+    std::iota(parent.begin(), parent.end(), 0);
+    for (const Pair &pair : pairs) {
+        if (pair.coplanar) {
+            int p = findRoot(parent, a.triangles[pair.tri[0]].region),
+                q = findRoot(parent, b.triangles[pair.tri[1]].region);
+            parent[std::max(p, q)] = std::min(p, q);
+        }
+    }
+    for (int s = 0; s < 2; s++) {
+        for (Triangle &tri : sides[s].triangles)
+            tri.region = findRoot(parent, tri.region);
+    }
+}
+
+void Boolean::findRegionEdges() {
+    regions.resize(planes.size());
+    for (int s = 0; s < 2; s++) {
+        for (int t = 0; t < (int)sides[s].triangles.size(); t++) {
+            Region &region = regions[sides[s].triangles[t].region];
+            region.count++;
+            region.side = s;
+            region.tri = t;
+        }
+    }
+    // a triangle alone in its region meets each other region along at most one edge, so only
+    // larger regions need their edges listed
+    for (int s = 0; s < 2; s++) {
+        const std::vector<Triangle> &triangles = sides[s].triangles;
+        for (int t = 0; t < (int)triangles.size(); t++) {
+            const Triangle &tri = triangles[t];
+            for (int k = 0; k < 3; k++) {
+                int n = tri.neighbor[k];
+                if (n < t)
+                    continue;
+                int p = tri.region, q = triangles[n].region;
+                if (p != q && (regions[p].count > 1 || regions[q].count > 1)) {
+                    int v0 = tri.v[k], v1 = tri.v[(k + 1) % 3];
+                    regionEdges.push_back({std::min(p, q), std::max(p, q), s,
+                        std::min(v0, v1), std::max(v0, v1)});
+                }
+            }
+        }
+    }
+    std::sort(regionEdges.begin(), regionEdges.end(),
+        [](const RegionEdge &e, const RegionEdge &f) {
+            return std::tie(e.a, e.b) < std::tie(f.a, f.b);
+        });
+}
+
+void Boolean::addEdgePlanes() {
+    // coplanar triangles are clipped to each other's edges, by planes through the edge which
+    // are perpendicular to the region
+    for (int s = 0; s < 2; s++) {
+        const Side &side = sides[s], &other = sides[1 - s];
+        for (const Candidate &candidate : other.candidates) {
+            if (!candidate.coplanar)
+                continue;
+            const Triangle &tri = side.triangles[candidate.tri];
+            for (int k = 0; k < 3; k++) {
+                int v0 = tri.v[k], v1 = tri.v[(k + 1) % 3];
+                edgePlanes.push_back({s, std::min(v0, v1), std::max(v0, v1), tri.region, 0});
+            }
+        }
+    }
+    auto tuple = [](const EdgePlane &e) { return std::tie(e.side, e.lo, e.hi, e.region); };
+    std::sort(edgePlanes.begin(), edgePlanes.end(), [&](const EdgePlane &e, const EdgePlane &f) {
+        return tuple(e) < tuple(f);
+    });
+    edgePlanes.erase(std::unique(edgePlanes.begin(), edgePlanes.end(),
+        [&](const EdgePlane &e, const EdgePlane &f) { return tuple(e) == tuple(f); }),
+        edgePlanes.end());
+    for (EdgePlane &e : edgePlanes) {
+        glm::dvec3 lo = sides[e.side].positions[e.lo], hi = sides[e.side].positions[e.hi];
+        glm::dvec3 normal = planes[e.region].normal();
+        normal *= glm::length(hi - lo) / glm::length(normal);
+        e.plane = (int)planes.size();
+        planes.push_back({{lo, hi, lo + normal}});
+    }
+}
+
+int Boolean::edgePlane(int s, int lo, int hi, int region) const {
+    EdgePlane key{s, lo, hi, region, 0};
+    auto it = std::lower_bound(edgePlanes.begin(), edgePlanes.end(), key,
+        [](const EdgePlane &e, const EdgePlane &f) {
+            return std::tie(e.side, e.lo, e.hi, e.region) < std::tie(f.side, f.lo, f.hi, f.region);
+        });
+    return it->plane;
+}
+
+bool Boolean::sharedEdge(int p, int q, int *s, int *lo, int *hi) const {
+    if (p == q || p >= (int)regions.size() || q >= (int)regions.size())
+        return false; // edge planes aren't regions
+    const Region &rp = regions[p], &rq = regions[q];
+    if (rp.count == 1 && rq.count == 1) {
+        if (rp.side != rq.side)
+            return false;
+        const Triangle &tri = sides[rp.side].triangles[rp.tri];
+        for (int k = 0; k < 3; k++) {
+            if (tri.neighbor[k] == rq.tri) {
+                *s = rp.side;
+                *lo = std::min(tri.v[k], tri.v[(k + 1) % 3]);
+                *hi = std::max(tri.v[k], tri.v[(k + 1) % 3]);
+                return true;
+            }
+        }
+        return false;
+    }
+    RegionEdge key{std::min(p, q), std::max(p, q), 0, 0, 0};
+    auto range = std::equal_range(regionEdges.begin(), regionEdges.end(), key,
+        [](const RegionEdge &e, const RegionEdge &f) {
+            return std::tie(e.a, e.b) < std::tie(f.a, f.b);
+        });
+    if (range.second - range.first != 1)
+        return false;
+    *s = range.first->side;
+    *lo = range.first->lo;
+    *hi = range.first->hi;
+    return true;
+}
+
+Line Boolean::regionLine(int p, int q) const {
+    // two planes at a shallow angle would give a badly placed line, the edge itself is exact
+    int s, lo, hi;
+    if (sharedEdge(p, q, &s, &lo, &hi))
+        return {1 + s, lo, hi};
+    return planeLine(p, q);
+}
+
+Line Boolean::edgeLine(int s, int t, int k) const {
+    const Triangle &tri = sides[s].triangles[t];
+    int n = tri.neighbor[k];
+    if (n >= 0 && sides[s].triangles[n].region != tri.region)
+        return regionLine(tri.region, sides[s].triangles[n].region);
+    int v0 = tri.v[k], v1 = tri.v[(k + 1) % 3];
+    return {1 + s, std::min(v0, v1), std::max(v0, v1)};
+}
+
+double Boolean::side(const Point &point, int plane) const {
+    const Key &key = point.key;
+    if (key.kind == Key::PLANES) {
+        if (key.a == plane || key.b == plane || key.c == plane)
+            return 0;
+    } else if (key.kind == Key::EDGE_PLANE) {
+        if (key.d == plane)
+            return 0;
+        // also on every plane through the edge. its ends are exact
+        const std::vector<glm::dvec3> &positions = sides[key.a].positions;
+        if (planes[plane].side(positions[key.b]) == 0
+                && planes[plane].side(positions[key.c]) == 0)
+            return 0;
+    }
+    return planes[plane].side(point.pos);
+}
+
+// false where that can't be told exactly
+bool Boolean::onPlane(const Line &line, int plane) const {
+    if (line.kind == 0)
+        return line.a == plane || line.b == plane;
+    const std::vector<glm::dvec3> &positions = sides[line.kind - 1].positions;
+    return planes[plane].side(positions[line.a]) == 0 && planes[plane].side(positions[line.b]) == 0;
+}
+
+bool Boolean::planesPoint(const int ids[3], glm::dvec3 *pos) const {
+    // relative to a point on the first plane to keep the numbers small
+    glm::dvec3 origin = planes[ids[0]].p[0];
+    glm::dvec3 n1 = planes[ids[0]].normal(), n2 = planes[ids[1]].normal(),
+        n3 = planes[ids[2]].normal();
+    double d2 = glm::dot(n2, planes[ids[1]].p[0] - origin),
+        d3 = glm::dot(n3, planes[ids[2]].p[0] - origin);
+    glm::dvec3 c23 = glm::cross(n2, n3);
+    double det = glm::dot(n1, c23);
+    if (det == 0)
+        return false;
+    *pos = origin + (d2 * glm::cross(n3, n1) + d3 * glm::cross(n1, n2)) / det;
+    return true;
+}
+
+Point Boolean::intersect(const Line &line, int plane, const Point &from,
+        const Point &to) const {
+    Point point;
+    Line edge = line;
+    int across = plane; // the plane crossing the edge, if the line goes through one
+    if (line.kind == 0) {
+        // where one plane of the line meets the other plane at an edge, the point is on that edge
+        int s, lo, hi;
+        if (sharedEdge(line.a, plane, &s, &lo, &hi)) {
+            edge = {1 + s, lo, hi};
+            across = line.b;
+        } else if (sharedEdge(line.b, plane, &s, &lo, &hi)) {
+            edge = {1 + s, lo, hi};
+            across = line.a;
+        }
+    }
+    if (edge.kind == 0) {
+        int ids[3] = {line.a, line.b, plane};
+        std::sort(ids, ids + 3);
+        point.key = {Key::PLANES, ids[0], ids[1], ids[2], 0};
+        if (planesPoint(ids, &point.pos))
+            return point;
+    } else {
+        int s = edge.kind - 1;
+        point.key = {Key::EDGE_PLANE, s, edge.a, edge.b, across};
+        glm::dvec3 p0 = sides[s].positions[edge.a], p1 = sides[s].positions[edge.b];
+        double d0 = planes[across].side(p0), d1 = planes[across].side(p1);
+        if (d0 != d1) {
+            point.pos = p0 + (p1 - p0) * (d0 / (d0 - d1));
+            return point;
+        }
+    }
+    // parallel, which the exact side tests say can't happen. something close will do
+    point.pos = (from.pos + to.pos) * 0.5;
+    return point;
+}
+
+int Boolean::split(const Fragment &frag, int plane, const Line &cut, Fragment *front,
+        Fragment *back, Contacts *contacts) const {
+    int n = (int)frag.points.size();
+    std::vector<double> dist(n);
+    bool above = false, below = false;
+    for (int i = 0; i < n; i++) {
+        dist[i] = side(frag.points[i], plane);
+        above = above || dist[i] > 0;
+        below = below || dist[i] < 0;
+    }
+    // the other side's edges along the cut line need points which are exactly on it, and edges
+    // of this fragment along it may be called something else
+    for (int i = 0; i < n && (above || below); i++) {
+        if (dist[i] != 0)
+            continue;
+        contacts->points.push_back({frag.points[i], cut});
+        // both ends on the plane isn't enough, they can be the same point made two ways
+        if (dist[(i + 1) % n] == 0 && !(frag.lines[i] == cut) && onPlane(frag.lines[i], plane))
+            contacts->lines.push_back({frag.lines[i], cut});
+    }
+    if (!below)
+        return 1;
+    if (!above)
+        return -1;
+    // each corner remembers where it was on the boundary: 2i for point i, 2i + 1 for the
+    // middle of edge i. that tells which corners are joined by the original edges
+    std::vector<std::pair<Point, int>> corners[2];
+    for (int i = 0; i < n; i++) {
+        int j = (i + 1) % n;
+        if (dist[i] >= 0)
+            corners[0].push_back({frag.points[i], 2 * i});
+        if (dist[i] <= 0)
+            corners[1].push_back({frag.points[i], 2 * i});
+        if ((dist[i] > 0 && dist[j] < 0) || (dist[i] < 0 && dist[j] > 0)) {
+            Point point = intersect(frag.lines[i], plane, frag.points[i], frag.points[j]);
+            corners[0].push_back({point, 2 * i + 1});
+            corners[1].push_back({point, 2 * i + 1});
+        }
+    }
+    Fragment *pieces[2] = {front, back};
+    for (int p = 0; p < 2; p++) {
+        Fragment *piece = pieces[p];
+        piece->points.clear();
+        piece->lines.clear();
+        piece->coplanar = frag.coplanar;
+        int m = (int)corners[p].size();
+        for (int k = 0; k < m; k++) {
+            int at = corners[p][k].second, nextAt = corners[p][(k + 1) % m].second;
+            int edge = at / 2;
+            int along = (nextAt - at + 2 * n) % (2 * n);
+            piece->points.push_back(corners[p][k].first);
+            piece->lines.push_back(along <= 2 * edge + 2 - at ? frag.lines[edge] : cut);
+        }
+    }
+    return 0;
+}
+
+void Boolean::clipCoplanar(int s, int t, const Candidate &candidate,
+        std::vector<Fragment> *fragments, Contacts *contacts) const {
+    const Triangle &tri = sides[s].triangles[t];
+    const Side &other = sides[1 - s];
+    const Triangle &otherTri = other.triangles[candidate.tri];
+    // only what's inside all three edges is on the other triangle
+    std::vector<Fragment> in, next;
+    in.swap(*fragments);
+    for (int k = 0; k < 3 && !in.empty(); k++) {
+        int v0 = otherTri.v[k], v1 = otherTri.v[(k + 1) % 3];
+        int plane = edgePlane(1 - s, std::min(v0, v1), std::max(v0, v1), otherTri.region);
+        Line cut = edgeLine(1 - s, candidate.tri, k);
+        int inner = planes[plane].side(other.positions[otherTri.v[(k + 2) % 3]]) > 0 ? 1 : -1;
+        next.clear();
+        for (Fragment &frag : in) {
+            Fragment front, back;
+            int result = split(frag, plane, cut, &front, &back, contacts);
+            if (result == 0) {
+                next.push_back(std::move(inner > 0 ? front : back));
+                fragments->push_back(std::move(inner > 0 ? back : front));
+            } else if (result == inner) {
+                next.push_back(std::move(frag));
+            } else {
+                fragments->push_back(std::move(frag));
+            }
+        }
+        in.swap(next);
+    }
+    // they share a plane now, the triangles themselves have the orientation
+    const std::vector<glm::dvec3> &pos = sides[s].positions, &otherPos = other.positions;
+    glm::dvec3 normal = glm::cross(pos[tri.v[1]] - pos[tri.v[0]], pos[tri.v[2]] - pos[tri.v[0]]);
+    glm::dvec3 otherNormal = glm::cross(otherPos[otherTri.v[1]] - otherPos[otherTri.v[0]],
+        otherPos[otherTri.v[2]] - otherPos[otherTri.v[0]]);
+    int facing = glm::dot(normal, otherNormal) > 0 ? 1 : -1;
+    for (Fragment &frag : in) {
+        frag.coplanar = facing;
+        fragments->push_back(std::move(frag));
+    }
+}
+
+void Boolean::splitTriangles(int s) {
+    Side &side = sides[s];
+    const Side &other = sides[1 - s];
+    side.fragments.resize(side.cut.size());
+    side.contacts.resize(side.cut.size());
+    parallelFor(side.cut.size(), [&](size_t begin, size_t end) {
+        std::vector<int> applied;
+        std::vector<Fragment> next;
+        for (size_t c = begin; c < end; c++) {
+            int t = side.cut[c];
+            const Triangle &tri = side.triangles[t];
+            std::vector<Fragment> &fragments = side.fragments[c];
+            Contacts *contacts = &side.contacts[c];
+            fragments.resize(1);
+            for (int k = 0; k < 3; k++) {
+                fragments[0].points.push_back({{Key::ORIGINAL, s, tri.v[k], 0, 0},
+                    side.positions[tri.v[k]]});
+                fragments[0].lines.push_back(edgeLine(s, t, k));
+            }
+            applied.clear();
+            for (int i = side.candidateStart[c]; i < side.candidateStart[c + 1]; i++) {
+                const Candidate &candidate = side.candidates[i];
+                if (candidate.coplanar) {
+                    clipCoplanar(s, t, candidate, &fragments, contacts);
+                    continue;
+                }
+                // every triangle in a flat region of the other side cuts along the same plane
+                int plane = other.triangles[candidate.tri].region;
+                if (std::find(applied.begin(), applied.end(), plane) != applied.end())
+                    continue;
+                applied.push_back(plane);
+                Line cut = regionLine(tri.region, plane);
+                next.clear();
+                for (Fragment &frag : fragments) {
+                    Fragment front, back;
+                    if (split(frag, plane, cut, &front, &back, contacts) == 0) {
+                        next.push_back(std::move(front));
+                        next.push_back(std::move(back));
+                    } else {
+                        next.push_back(std::move(frag));
+                    }
+                }
+                fragments.swap(next);
+            }
+        }
+    }, 16);
+}
+
+bool Boolean::winding(int s, glm::dvec3 point, glm::dvec3 dir, int *number) const {
+    const Side &side = sides[s];
+    glm::dvec3 min = side.total.min, max = side.total.max;
+    double reach = glm::length(max - min) + glm::length(point - (min + max) * 0.5) + 1;
+    glm::dvec3 end = point + dir * (2 * reach);
+    int count = 0;
+    bool clear = true;
+    side.bvh.traverse([&](const Bounds &box) {
+        return clear && segmentHitsBox(point, end, box);
+    }, [&](int t) {
+        if (!clear || side.degenerate[t])
+            return;
+        const Triangle &tri = side.triangles[t];
+        int crossing = crossSegment(point, end, side.positions[tri.v[0]],
+            side.positions[tri.v[1]], side.positions[tri.v[2]]);
+        if (crossing == CROSS_DEGENERATE)
+            clear = false;
+        else
+            count += crossing;
+    });
+    *number = count;
+    return clear;
+}
+
+bool Boolean::inside(int s, glm::dvec3 point, bool *result) const {
+    const Bounds &total = sides[s].total;
+    if (point.x < total.min.x || point.y < total.min.y || point.z < total.min.z
+            || point.x > total.max.x || point.y > total.max.y || point.z > total.max.z) {
+        *result = false;
+        return true;
+    }
+    // unlikely to line up with anything, try another if it touches an edge
+    static const glm::dvec3 dirs[] = {
+        {0.5387236, 0.6402419, 0.5475683}, {-0.3118530, 0.8243096, -0.4724190},
+        {0.7316958, -0.2213567, -0.6446281}};
+    for (glm::dvec3 dir : dirs) {
+        int number;
+        if (winding(s, point, dir, &number)) {
+            *result = number > 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Boolean::keep(int s, bool inside, int coplanar) const {
+    if (coplanar)
+        return s == 0 && (op == BOOLEAN_DIFFERENCE ? coplanar < 0 : coplanar > 0);
+    switch (op) {
+        case BOOLEAN_UNION:
+            return !inside;
+        case BOOLEAN_INTERSECTION:
+            return inside;
+        default:
+            return s == 0 ? !inside : inside;
+    }
+}
+
+void Boolean::classify(int s) {
+    Side &side = sides[s];
+    int other = 1 - s;
+    parallelFor(side.cut.size(), [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; c++) {
+            for (Fragment &frag : side.fragments[c]) {
+                if (frag.coplanar) {
+                    frag.keep = keep(s, false, frag.coplanar);
+                    continue;
+                }
+                glm::dvec3 center(0);
+                for (const Point &point : frag.points)
+                    center += point.pos;
+                center /= (double)frag.points.size();
+                // if the center is exactly on the other surface, try towards each corner
+                bool in = false;
+                if (!inside(other, center, &in)) {
+                    for (const Point &point : frag.points) {
+                        if (inside(other, (center + point.pos) * 0.5, &in))
+                            break;
+                    }
+                }
+                frag.keep = keep(s, in, 0);
+            }
+        }
+    }, 16);
+
+    // the rest in connected regions which don't cross the other surface
+    int numTris = (int)side.triangles.size();
+    std::vector<int> parent(numTris);
+    std::iota(parent.begin(), parent.end(), 0);
+    for (int t = 0; t < numTris; t++) {
+        if (side.cutIndex[t] >= 0)
+            continue;
+        for (int n : side.triangles[t].neighbor) {
+            if (n >= 0 && side.cutIndex[n] < 0)
+                parent[findRoot(parent, n)] = findRoot(parent, t);
+        }
+    }
+    // prefer a triangle outside the bounds of the other side, which needs no test
+    std::vector<int> sample(numTris, -1), roots;
+    for (int t = 0; t < numTris; t++) {
+        if (side.cutIndex[t] >= 0)
+            continue;
+        int root = findRoot(parent, t);
+        int &best = sample[root];
+        if (best < 0)
+            roots.push_back(root);
+        if (best < 0 || (side.degenerate[best] && !side.degenerate[t])
+                || (side.bounds[best].overlaps(sides[other].total)
+                    && !side.bounds[t].overlaps(sides[other].total)))
+            best = t;
+    }
+    std::vector<char> keepRoot(numTris, 0);
+    parallelFor(roots.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const Triangle &tri = side.triangles[sample[roots[i]]];
+            glm::dvec3 p0 = side.positions[tri.v[0]], p1 = side.positions[tri.v[1]],
+                p2 = side.positions[tri.v[2]];
+            bool in = false;
+            if (!inside(other, (p0 + p1 + p2) / 3.0, &in)
+                    && !inside(other, (p0 * 2.0 + p1 + p2) * 0.25, &in))
+                inside(other, (p0 + p1 * 2.0 + p2) * 0.25, &in);
+            keepRoot[roots[i]] = keep(s, in, 0);
+        }
+    }, 16);
+    side.keepTriangle.resize(numTris);
+    for (int t = 0; t < numTris; t++)
+        side.keepTriangle[t] = side.cutIndex[t] < 0 && keepRoot[findRoot(parent, t)];
+}
+
+Line Boolean::lineKey(const Line &line) const {
+    Line key = line;
+    for (auto it = sameLine.find(key); it != sameLine.end(); it = sameLine.find(key))
+        key = it->second;
+    return key;
+}
+
+void Boolean::joinLines(const Line &a, const Line &b) {
+    Line p = lineKey(a), q = lineKey(b);
+    if (!(p == q))
+        sameLine[p] = q;
+    // point everything on the way straight at the key, so later lookups are short
+    for (Line line : {a, b}) {
+        while (!(line == q)) {
+            Line next = sameLine[line];
+            sameLine[line] = q;
+            line = next;
+        }
+    }
+}
+
+glm::dvec3 Boolean::lineDirection(const Line &line) const {
+    if (line.kind == 0)
+        return glm::cross(planes[line.a].normal(), planes[line.b].normal());
+    const std::vector<glm::dvec3> &positions = sides[line.kind - 1].positions;
+    return positions[line.b] - positions[line.a];
+}
+
+void Boolean::appendEdge(std::vector<int> *verts, const Line &line, int from, int to) const {
+    verts->push_back(from);
+    Line key = lineKey(line);
+    auto it = linePoints.find(key);
+    if (it == linePoints.end())
+        return;
+    // points of other edges on the same line which land inside this one
+    const std::vector<std::pair<double, int>> &points = it->second;
+    glm::dvec3 dir = lineDirection(key);
+    double t0 = glm::dot(exact[from], dir), t1 = glm::dot(exact[to], dir);
+    if (t0 < t1) {
+        auto p = std::upper_bound(points.begin(), points.end(), std::make_pair(t0, INT32_MAX));
+        for (; p != points.end() && p->first < t1; ++p) {
+            if (p->second != from && p->second != to)
+                verts->push_back(p->second);
+        }
+    } else {
+        auto p = std::lower_bound(points.begin(), points.end(), std::make_pair(t0, INT32_MIN));
+        while (p != points.begin()) {
+            --p;
+            if (p->first <= t1)
+                break;
+            if (p->second != from && p->second != to)
+                verts->push_back(p->second);
+        }
+    }
+}
+
+// drop repeats left behind by merged points, and spikes going out to a point and straight back.
+// a face which merging pinched together at a vertex is split there
+static void addFace(std::vector<int> verts, bool reverse, std::vector<int> *faceSizes,
+        std::vector<int> *faceVerts) {
+    std::vector<int> out;
+    for (int v : verts) {
+        if (!out.empty() && out.back() == v)
+            continue;
+        if (out.size() >= 2 && out[out.size() - 2] == v) {
+            out.pop_back();
+            continue;
+        }
+        out.push_back(v);
+    }
+    while (out.size() >= 2) {
+        size_t n = out.size();
+        if (out[0] == out[n - 1]) {
+            out.pop_back();
+        } else if (n >= 3 && out[1] == out[n - 1]) {
+            out.erase(out.begin());
+            out.pop_back();
+        } else if (n >= 3 && out[n - 2] == out[0]) {
+            out.pop_back();
+        } else {
+            break;
+        }
+    }
+    if (out.size() < 3)
+        return;
+    std::vector<int> sorted = out;
+    std::sort(sorted.begin(), sorted.end());
+    if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end()) {
+        for (size_t i = 0; i < out.size(); i++) {
+            for (size_t j = i + 1; j < out.size(); j++) {
+                if (out[i] == out[j]) {
+                    std::vector<int> other(out.begin() + j, out.end());
+                    other.insert(other.end(), out.begin(), out.begin() + i);
+                    addFace(std::vector<int>(out.begin() + i, out.begin() + j), reverse,
+                        faceSizes, faceVerts);
+                    addFace(std::move(other), reverse, faceSizes, faceVerts);
+                    return;
+                }
+            }
+        }
+    }
+    if (reverse)
+        std::reverse(out.begin(), out.end());
+    faceSizes->push_back((int)out.size());
+    faceVerts->insert(faceVerts->end(), out.begin(), out.end());
+}
+
+// buildSurface keeps every face around a vertex, even when they form separate fans (solids
+// touching at a point). give each extra fan its own vertex
+static void splitVertexFans(Surface *surface) {
+    std::vector<char> reached(surface->edges.size(), 0);
+    for (auto &vert : surface->vertices) {
+        for (ITER_VERTEX_EDGES(vert.get(), edge))
+            reached[edge->index] = 1;
+    }
+    for (size_t i = 0; i < reached.size(); i++) {
+        if (reached[i])
+            continue;
+        HEdge *start = surface->edges[i].get();
+        Vertex *vert = surface->newVertex();
+        vert->pos = start->vert->pos;
+        vert->edge = start;
+        for (ITER_VERTEX_EDGES(vert, edge)) {
+            edge->vert = vert;
+            reached[edge->index] = 1;
+        }
+    }
+}
+
+bool Boolean::build(Surface *result) {
+    // original vertices of both sides keep their indices, new points go after
+    int base[2] = {0, (int)sides[0].positions.size()};
+    int numOriginal = base[1] + (int)sides[1].positions.size();
+    exact.clear();
+    for (int s = 0; s < 2; s++)
+        exact.insert(exact.end(), sides[s].positions.begin(), sides[s].positions.end());
+    std::vector<int> remap(numOriginal);
+    std::iota(remap.begin(), remap.end(), 0);
+
+    // the same spot can be reached by different constructions (a vertex exactly on a plane of
+    // the other side), so points within rounding error of each other are merged. originals go
+    // first so faces which weren't cut can still refer to them by index
+    double scale = 0;
+    for (int s = 0; s < 2; s++) {
+        if (!sides[s].total.empty()) {
+            glm::vec3 size = glm::max(glm::abs(sides[s].total.min), glm::abs(sides[s].total.max));
+            scale = std::max(scale, (double)std::max(size.x, std::max(size.y, size.z)));
+        }
+    }
+    PointGrid grid;
+    grid.cell = std::max(scale * DBL_EPSILON * 4096, DBL_MIN);
+    for (int s = 0; s < 2; s++) {
+        for (const Contacts &contacts : sides[s].contacts) {
+            for (auto &lines : contacts.lines)
+                joinLines(lines.first, lines.second);
+        }
+    }
+    for (int s = 0; s < 2; s++) {
+        for (auto &fragments : sides[s].fragments) {
+            for (Fragment &frag : fragments) {
+                if (!frag.keep)
+                    continue;
+                for (const Point &point : frag.points) {
+                    if (point.key.kind == Key::ORIGINAL) {
+                        int index = base[s] + point.key.b;
+                        if (remap[index] == index)
+                            remap[index] = grid.find(exact, point.pos, index);
+                    }
+                }
+            }
+        }
+    }
+    for (int s = 0; s < 2; s++) {
+        for (auto &fragments : sides[s].fragments) {
+            for (Fragment &frag : fragments) {
+                if (!frag.keep)
+                    continue;
+                for (const Point &point : frag.points) {
+                    if (point.key.kind == Key::ORIGINAL) {
+                        frag.verts.push_back(remap[base[s] + point.key.b]);
+                        continue;
+                    }
+                    int index = grid.find(exact, point.pos, (int)exact.size());
+                    if (index == (int)exact.size())
+                        exact.push_back(point.pos);
+                    frag.verts.push_back(index);
+                }
+                // every end of a kept edge, so other edges on the same line can pick them up
+                size_t n = frag.verts.size();
+                for (size_t i = 0; i < n; i++) {
+                    auto &list = linePoints[lineKey(frag.lines[i])];
+                    list.push_back({0.0, frag.verts[i]});
+                    list.push_back({0.0, frag.verts[(i + 1) % n]});
+                }
+            }
+        }
+    }
+    // points found exactly on a line without an edge along it, if they made it into the output
+    std::vector<char> used(exact.size(), 0);
+    for (int s = 0; s < 2; s++) {
+        const Side &side = sides[s];
+        for (int t = 0; t < (int)side.triangles.size(); t++) {
+            if (side.cutIndex[t] < 0 && side.keepTriangle[t]) {
+                for (int v : side.triangles[t].v)
+                    used[remap[base[s] + v]] = 1;
+            }
+        }
+        for (auto &fragments : side.fragments) {
+            for (const Fragment &frag : fragments) {
+                for (int v : frag.verts)
+                    used[v] = 1;
+            }
+        }
+    }
+    for (int s = 0; s < 2; s++) {
+        for (const Contacts &contacts : sides[s].contacts) {
+            for (auto &contact : contacts.points) {
+                const Point &point = contact.first;
+                int index = point.key.kind == Key::ORIGINAL ? remap[base[s] + point.key.b]
+                    : grid.near(exact, point.pos);
+                if (index >= 0 && used[index])
+                    linePoints[lineKey(contact.second)].push_back({0.0, index});
+            }
+        }
+    }
+    for (auto &entry : linePoints) {
+        glm::dvec3 dir = lineDirection(entry.first);
+        for (auto &point : entry.second)
+            point.first = glm::dot(exact[point.second], dir);
+        std::sort(entry.second.begin(), entry.second.end());
+        entry.second.erase(std::unique(entry.second.begin(), entry.second.end()),
+            entry.second.end());
+    }
+
+    std::vector<int> faceSizes, faceVerts, verts;
+    for (int s = 0; s < 2; s++) {
+        const Side &side = sides[s];
+        bool reverse = op == BOOLEAN_DIFFERENCE && s == 1;
+        auto vertIndex = [&](int v) { return remap[base[s] + v]; };
+        // an edge next to a cut triangle may have picked up points from its pieces
+        auto appendTriEdge = [&](int t, int k) {
+            const Triangle &tri = side.triangles[t];
+            int from = vertIndex(tri.v[k]), to = vertIndex(tri.v[(k + 1) % 3]);
+            if (tri.neighbor[k] >= 0 && side.cutIndex[tri.neighbor[k]] >= 0)
+                appendEdge(&verts, edgeLine(s, t, k), from, to);
+            else
+                verts.push_back(from);
+        };
+        for (size_t f = 0; f < side.surface->faces.size(); f++) {
+            int first = side.faceStart[f], last = side.faceStart[f + 1];
+            bool whole = true;
+            for (int t = first; t < last && whole; t++)
+                whole = side.cutIndex[t] < 0;
+            if (whole) {
+                if (first == last || !side.keepTriangle[first])
+                    continue;
+                verts.clear();
+                for (ITER_FACE_EDGES(side.surface->faces[f].get(), edge)) {
+                    int tk = side.edgeTriangle[edge->index];
+                    appendTriEdge(tk / 3, tk % 3);
+                }
+                addFace(verts, reverse, &faceSizes, &faceVerts);
+                continue;
+            }
+            for (int t = first; t < last; t++) {
+                int c = side.cutIndex[t];
+                if (c < 0) {
+                    if (!side.keepTriangle[t])
+                        continue;
+                    verts.clear();
+                    for (int k = 0; k < 3; k++)
+                        appendTriEdge(t, k);
+                    addFace(verts, reverse, &faceSizes, &faceVerts);
+                    continue;
+                }
+                for (const Fragment &frag : side.fragments[c]) {
+                    if (!frag.keep)
+                        continue;
+                    verts.clear();
+                    size_t n = frag.verts.size();
+                    for (size_t i = 0; i < n; i++)
+                        appendEdge(&verts, frag.lines[i], frag.verts[i], frag.verts[(i + 1) % n]);
+                    addFace(verts, reverse, &faceSizes, &faceVerts);
+                }
+            }
+        }
+    }
+
+    std::vector<glm::vec3> positions(exact.size());
+    for (size_t i = 0; i < exact.size(); i++)
+        positions[i] = exact[i];
+    Surface surface;
+    if (!buildSurface(&surface, positions, faceSizes, faceVerts)) {
+        wprintf(L"Boolean result is not a closed manifold surface!\n");
+        return false;
+    }
+    splitVertexFans(&surface);
+    *result = std::move(surface);
+    return true;
+}
+
+bool booleanSurfaces(Surface *result, const Surface &a, const Surface &b, BooleanOp op) {
+    Boolean boolean(op);
+    boolean.prepare(0, a);
+    boolean.prepare(1, b);
+    parallelFor(2, [&](size_t begin, size_t end) {
+        for (size_t s = begin; s < end; s++)
+            boolean.sides[s].bvh.build(boolean.sides[s].bounds);
+    }, 1);
+    boolean.findCandidates();
+    boolean.findRegionEdges();
+    boolean.addEdgePlanes();
+    for (int s = 0; s < 2; s++)
+        boolean.splitTriangles(s);
+    for (int s = 0; s < 2; s++)
+        boolean.classify(s);
+    return boolean.build(result);
+}
+
+} // namespace
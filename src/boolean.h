@@ -0,0 +1,24 @@
+#pragma once
+#include <common.h>
+
+#include "surface.h"
+
+namespace winged {
+
+enum BooleanOp {
+    BOOLEAN_UNION,
+    BOOLEAN_INTERSECTION,
+    BOOLEAN_DIFFERENCE, // a minus b
+};
+
+// combine two closed surfaces as solids, replacing the contents of result (which may be a or
+// b). faces which cross the other surface are split along the planes of the faces they cross;
+// every new vertex is computed the same way from either side, so the pieces meet exactly. each
+// piece is kept or dropped by its winding number around the other surface, counted with exact
+// predicates. faces away from the intersection keep their shape and are classified one
+// connected region at a time. coplanar faces facing the same way keep a's copy.
+// returns false and leaves result unchanged if the result isn't a closed manifold surface (eg.
+// the solids only touch along an edge). O(n log n), the work is spread over all cores
+bool booleanSurfaces(Surface *result, const Surface &a, const Surface &b, BooleanOp op);
+
+} // namespace
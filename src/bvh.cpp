@@ -0,0 +1,107 @@
+#include "bvh.h"
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+namespace winged {
+
+static const int LEAF_SIZE = 4;
+
+float Bounds::intersectRay(glm::vec3 origin, glm::vec3 invDir, float maxT) const {
+    // slab test
+    glm::vec3 t1 = (min - origin) * invDir, t2 = (max - origin) * invDir;
+    glm::vec3 tMin = glm::min(t1, t2), tMax = glm::max(t1, t2);
+    float enter = std::max(std::max(tMin.x, tMin.y), std::max(tMin.z, 0.0f));
+    float exit = std::min(std::min(tMax.x, tMax.y), std::min(tMax.z, maxT));
+    return enter <= exit ? enter : -1;
+}
+
+void BVH::build(const std::vector<Bounds> &primBounds) {
+    clear();
+    if (primBounds.empty())
+        return;
+    int count = (int)primBounds.size();
+    prims.resize(count);
+    std::vector<glm::vec3> centers(count);
+    for (int i = 0; i < count; i++) {
+        prims[i] = i;
+        centers[i] = primBounds[i].center();
+    }
+    nodes.reserve(count / LEAF_SIZE * 2 + 1);
+    buildNode(primBounds, centers, 0, count, -1);
+    primLeaf.resize(count);
+    for (int i = 0; i < (int)nodes.size(); i++) {
+        for (int p = nodes[i].first; p < nodes[i].first + nodes[i].count; p++)
+            primLeaf[prims[p]] = i;
+    }
+}
+
+int BVH::buildNode(const std::vector<Bounds> &primBounds, std::vector<glm::vec3> &centers,
+        int begin, int end, int parent) {
+    int index = (int)nodes.size();
+    nodes.emplace_back();
+    nodes[index].parent = parent;
+    Bounds bounds, centerBounds;
+    for (int i = begin; i < end; i++) {
+        bounds.extend(primBounds[prims[i]]);
+        centerBounds.extend(centers[prims[i]]);
+    }
+    nodes[index].bounds = bounds;
+    if (end - begin <= LEAF_SIZE) {
+        nodes[index].first = begin;
+        nodes[index].count = end - begin;
+        return index;
+    }
+
+    // median split along the longest axis of the centers
+    glm::vec3 size = centerBounds.max - centerBounds.min;
+    int axis = (size.x > size.y && size.x > size.z) ? 0 : (size.y > size.z ? 1 : 2);
+    int mid = (begin + end) / 2;
+    std::nth_element(prims.begin() + begin, prims.begin() + mid, prims.begin() + end,
+        [&](int a, int b) { return centers[a][axis] < centers[b][axis]; });
+    buildNode(primBounds, centers, begin, mid, index); // always index + 1
+    int right = buildNode(primBounds, centers, mid, end, index);
+    nodes[index].first = right;
+    nodes[index].count = 0;
+    return index;
+}
+
+void BVH::refit(const std::vector<Bounds> &primBounds) {
+    // children always come after their parent
+    for (int i = (int)nodes.size() - 1; i >= 0; i--)
+        refitNode(primBounds, i);
+}
+
+void BVH::refit(const std::vector<Bounds> &primBounds, const std::vector<int> &changed) {
+    // every node above a changed primitive, children first
+    std::vector<int> stale;
+    for (int prim : changed) {
+        for (int i = primLeaf[prim]; i >= 0; i = nodes[i].parent)
+            stale.push_back(i);
+    }
+    std::sort(stale.begin(), stale.end(), std::greater<int>());
+    stale.erase(std::unique(stale.begin(), stale.end()), stale.end());
+    for (int i : stale)
+        refitNode(primBounds, i);
+}
+
+void BVH::refitNode(const std::vector<Bounds> &primBounds, int index) {
+    Node &node = nodes[index];
+    Bounds bounds;
+    if (node.count) {
+        for (int p = node.first; p < node.first + node.count; p++)
+            bounds.extend(primBounds[prims[p]]);
+    } else {
+        bounds = nodes[index + 1].bounds;
+        bounds.extend(nodes[node.first].bounds);
+    }
+    node.bounds = bounds;
+}
+
+void BVH::clear() {
+    nodes.clear();
+    prims.clear();
+    primLeaf.clear();
+}
+
+} // namespace
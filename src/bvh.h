@@ -0,0 +1,180 @@
+#pragma once
+#include <common.h>
+
+#include <vector>
+#include <glm/glm/vec3.hpp>
+#include <glm/glm/common.hpp>
+
+namespace winged {
+
+// axis-aligned bounding box
+struct Bounds {
+    glm::vec3 min = glm::vec3(1e30f), max = glm::vec3(-1e30f); // initially empty
+
+    bool empty() const { return min.x > max.x; }
+    void extend(glm::vec3 point) {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+    void extend(const Bounds &other) {
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+    glm::vec3 center() const { return (min + max) * 0.5f; }
+    bool overlaps(const Bounds &other) const {
+        return min.x <= other.max.x && max.x >= other.min.x
+            && min.y <= other.max.y && max.y >= other.min.y
+            && min.z <= other.max.z && max.z >= other.min.z;
+    }
+    float distanceSquared(glm::vec3 point) const {
+        glm::vec3 d = glm::max(glm::max(min - point, point - max), glm::vec3(0));
+        return d.x * d.x + d.y * d.y + d.z * d.z;
+    }
+    // distance along ray to entry point, or a negative number if missed
+    float intersectRay(glm::vec3 origin, glm::vec3 invDir, float maxT) const;
+};
+
+// bounding volume hierarchy over primitives identified by their index in the bounds list
+class BVH {
+public:
+    void build(const std::vector<Bounds> &primBounds); // O(n log n)
+    // recompute node bounds after primitives moved, keeping the tree. O(n)
+    void refit(const std::vector<Bounds> &primBounds);
+    // the same when only the changed primitives moved. O(k log n)
+    void refit(const std::vector<Bounds> &primBounds, const std::vector<int> &changed);
+    void clear();
+    bool empty() const { return nodes.empty(); }
+    const Bounds & bounds() const { return nodes[0].bounds; }
+
+    // func(prim) for every primitive whose bounds overlap box
+    template<typename Func>
+    void query(const Bounds &box, Func func) const;
+    // closest primitive to point. distFunc(prim) returns squared distance.
+    // only distances below maxDistSquared are considered; it is updated to the best found
+    template<typename Func>
+    int nearest(glm::vec3 point, float *maxDistSquared, Func distFunc) const;
+    // func(prim) for every primitive whose bounds are hit by the ray within maxT
+    template<typename Func>
+    void raycast(glm::vec3 origin, glm::vec3 dir, float maxT, Func func) const;
+    // func(prim) for every primitive in nodes where test(const Bounds &) is true, for shapes
+    // the other queries don't cover
+    template<typename Test, typename Func>
+    void traverse(Test test, Func func) const;
+
+private:
+    struct Node {
+        Bounds bounds;
+        int first; // leaf: first index into prims. interior: index of second child
+        int count; // 0 for interior nodes, first child immediately follows
+        int parent; // -1 for the root
+    };
+    std::vector<Node> nodes;
+    std::vector<int> prims;
+    std::vector<int> primLeaf; // node containing each primitive
+
+    int buildNode(const std::vector<Bounds> &primBounds, std::vector<glm::vec3> &centers,
+        int begin, int end, int parent);
+    void refitNode(const std::vector<Bounds> &primBounds, int index);
+};
+
+template<typename Func>
+void BVH::query(const Bounds &box, Func func) const {
+    if (nodes.empty())
+        return;
+    int stack[64], top = 0;
+    stack[top++] = 0;
+    while (top) {
+        int index = stack[--top];
+        const Node &node = nodes[index];
+        if (!node.bounds.overlaps(box))
+            continue;
+        if (node.count) {
+            for (int i = node.first; i < node.first + node.count; i++)
+                func(prims[i]);
+        } else {
+            stack[top++] = node.first;
+            stack[top++] = index + 1;
+        }
+    }
+}
+
+template<typename Func>
+int BVH::nearest(glm::vec3 point, float *maxDistSquared, Func distFunc) const {
+    int best = -1;
+    if (nodes.empty())
+        return best;
+    int stack[64], top = 0;
+    stack[top++] = 0;
+    while (top) {
+        int index = stack[--top];
+        const Node &node = nodes[index];
+        if (node.bounds.distanceSquared(point) >= *maxDistSquared)
+            continue;
+        if (node.count) {
+            for (int i = node.first; i < node.first + node.count; i++) {
+                float dist = distFunc(prims[i]);
+                if (dist < *maxDistSquared) {
+                    *maxDistSquared = dist;
+                    best = prims[i];
+                }
+            }
+        } else {
+            // visit the closer child first (pushed last)
+            int left = index + 1, right = node.first;
+            if (nodes[left].bounds.distanceSquared(point)
+                    < nodes[right].bounds.distanceSquared(point)) {
+                stack[top++] = right;
+                stack[top++] = left;
+            } else {
+                stack[top++] = left;
+                stack[top++] = right;
+            }
+        }
+    }
+    return best;
+}
+
+template<typename Func>
+void BVH::raycast(glm::vec3 origin, glm::vec3 dir, float maxT, Func func) const {
+    if (nodes.empty())
+        return;
+    glm::vec3 invDir = 1.0f / dir;
+    int stack[64], top = 0;
+    stack[top++] = 0;
+    while (top) {
+        int index = stack[--top];
+        const Node &node = nodes[index];
+        if (node.bounds.intersectRay(origin, invDir, maxT) < 0)
+            continue;
+        if (node.count) {
+            for (int i = node.first; i < node.first + node.count; i++)
+                func(prims[i]);
+        } else {
+            stack[top++] = node.first;
+            stack[top++] = index + 1;
+        }
+    }
+}
+
+template<typename Test, typename Func>
+void BVH::traverse(Test test, Func func) const {
+    if (nodes.empty())
+        return;
+    int stack[64], top = 0;
+    stack[top++] = 0;
+    while (top) {
+        int index = stack[--top];
+        const Node &node = nodes[index];
+        if (!test(node.bounds))
+            continue;
+        if (node.count) {
+            for (int i = node.first; i < node.first + node.count; i++)
+                func(prims[i]);
+        } else {
+            stack[top++] = node.first;
+            stack[top++] = index + 1;
+        }
+    }
+}
+
+} // namespace
@@ -0,0 +1,455 @@
+#include "hull.h"
+#include "operations.h"
+#include "parallel.h"
+#include <cfloat>
+#include <cwchar>
+#include <mutex>
+#include <glm/glm/geometric.hpp>
+
+// https://archive.org/details/2014-gdc-quickhull (Dirk Gregorius, "Implementing Quickhull")
+
+namespace winged {
+
+namespace {
+
+// position is stored with the index, so scanning a conflict list doesn't jump around in memory
+struct ConflictPoint {
+    glm::vec3 pos;
+    int index;
+};
+
+struct HullFace {
+    int verts[3]; // counter-clockwise
+    int adjacent[3]; // face across edge verts[i] -> verts[i + 1]
+    glm::dvec3 normal;
+    double offset; // plane is dot(normal, p) = offset
+    std::vector<ConflictPoint> conflicts; // outside points which can see this face
+    int farthest = -1; // in conflicts
+    double farthestDist = 0;
+    bool alive = true;
+    int visited = -1; // iteration it was found visible
+};
+
+struct HorizonEdge {
+    int from, to;
+    int outside, outsideEdge; // face which stays, and the index of the edge in it
+};
+
+class QuickHull {
+public:
+    const std::vector<glm::vec3> &points;
+    double tolerance;
+    std::vector<HullFace> faces;
+    std::vector<int> freeFaces; // dead, can be reused
+    std::vector<std::pair<int, double>> assignment; // temporary for assignConflicts
+
+    QuickHull(const std::vector<glm::vec3> &points, double tolerance)
+        : points(points), tolerance(tolerance) {}
+
+    glm::dvec3 point(int i) const {
+        return glm::dvec3(points[i].x, points[i].y, points[i].z);
+    }
+    double distance(const HullFace &face, int i) const {
+        return glm::dot(face.normal, point(i)) - face.offset;
+    }
+    static double distance(const HullFace &face, glm::vec3 p) {
+        return face.normal.x * p.x + face.normal.y * p.y + face.normal.z * p.z - face.offset;
+    }
+
+    bool build();
+
+private:
+    int addFace(int a, int b, int c);
+    bool initialSimplex(int simplex[4]);
+    void assignConflicts(const std::vector<ConflictPoint> &pointList,
+        const std::vector<int> &newFaces);
+    void findHorizon(int eye, int start, int iteration, std::vector<int> *visible,
+        std::vector<HorizonEdge> *horizon);
+};
+
+} // namespace
+
+int QuickHull::addFace(int a, int b, int c) {
+    int index;
+    if (freeFaces.empty()) {
+        index = (int)faces.size();
+        faces.emplace_back();
+    } else {
+        index = freeFaces.back();
+        freeFaces.pop_back();
+    }
+    HullFace &face = faces[index];
+    face.conflicts.clear(); // keeps capacity
+    face.farthest = -1;
+    face.farthestDist = 0;
+    face.alive = true;
+    face.visited = -1;
+    face.verts[0] = a;
+    face.verts[1] = b;
+    face.verts[2] = c;
+    glm::dvec3 normal = glm::cross(point(b) - point(a), point(c) - point(a));
+    double length = glm::length(normal);
+    face.normal = length > 0 ? normal / length : normal;
+    face.offset = glm::dot(face.normal, point(a));
+    return index;
+}
+
+bool QuickHull::initialSimplex(int simplex[4]) {
+    // extreme points along each axis
+    int extremes[6] = {0, 0, 0, 0, 0, 0};
+    std::mutex mutex;
+    parallelFor(points.size(), [&](size_t begin, size_t end) {
+        int local[6];
+        for (int &e : local)
+            e = (int)begin;
+        for (size_t i = begin; i < end; i++) {
+            for (int axis = 0; axis < 3; axis++) {
+                if (points[i][axis] < points[local[axis * 2]][axis])
+                    local[axis * 2] = (int)i;
+                if (points[i][axis] > points[local[axis * 2 + 1]][axis])
+                    local[axis * 2 + 1] = (int)i;
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int axis = 0; axis < 3; axis++) {
+            if (points[local[axis * 2]][axis] < points[extremes[axis * 2]][axis])
+                extremes[axis * 2] = local[axis * 2];
+            if (points[local[axis * 2 + 1]][axis] > points[extremes[axis * 2 + 1]][axis])
+                extremes[axis * 2 + 1] = local[axis * 2 + 1];
+        }
+    });
+
+    // widest pair
+    double best = -1;
+    for (int axis = 0; axis < 3; axis++) {
+        glm::dvec3 diff = point(extremes[axis * 2 + 1]) - point(extremes[axis * 2]);
+        double dist = glm::dot(diff, diff);
+        if (dist > best) {
+            best = dist;
+            simplex[0] = extremes[axis * 2];
+            simplex[1] = extremes[axis * 2 + 1];
+        }
+    }
+    // farthest from the line, then from the plane
+    glm::dvec3 a = point(simplex[0]), dir = glm::normalize(point(simplex[1]) - a);
+    best = tolerance * tolerance;
+    simplex[2] = -1;
+    for (int i = 0; i < (int)points.size(); i++) {
+        glm::dvec3 offset = point(i) - a;
+        glm::dvec3 perp = offset - dir * glm::dot(offset, dir);
+        double dist = glm::dot(perp, perp);
+        if (dist > best) {
+            best = dist;
+            simplex[2] = i;
+        }
+    }
+    if (simplex[2] < 0)
+        return false;
+    glm::dvec3 normal = glm::normalize(glm::cross(point(simplex[1]) - a, point(simplex[2]) - a));
+    best = tolerance;
+    simplex[3] = -1;
+    for (int i = 0; i < (int)points.size(); i++) {
+        double dist = glm::abs(glm::dot(point(i) - a, normal));
+        if (dist > best) {
+            best = dist;
+            simplex[3] = i;
+        }
+    }
+    if (simplex[3] < 0)
+        return false;
+    // the first three counter-clockwise when seen from outside (away from the fourth)
+    if (glm::dot(point(simplex[3]) - a, normal) > 0)
+        std::swap(simplex[1], simplex[2]);
+    return true;
+}
+
+void QuickHull::assignConflicts(const std::vector<ConflictPoint> &pointList,
+        const std::vector<int> &newFaces) {
+    // each point goes to the face it is farthest outside of, or nowhere if it is inside
+    assignment.resize(pointList.size());
+    parallelFor(pointList.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            int best = -1;
+            double bestDist = tolerance;
+            for (int f : newFaces) {
+                double dist = distance(faces[f], pointList[i].pos);
+                if (dist > bestDist) {
+                    bestDist = dist;
+                    best = f;
+                }
+            }
+            assignment[i] = {best, bestDist};
+        }
+    }, 1024);
+    for (size_t i = 0; i < pointList.size(); i++) {
+        if (assignment[i].first < 0)
+            continue;
+        HullFace &face = faces[assignment[i].first];
+        face.conflicts.push_back(pointList[i]);
+        if (assignment[i].second > face.farthestDist) {
+            face.farthestDist = assignment[i].second;
+            face.farthest = pointList[i].index;
+        }
+    }
+}
+
+void QuickHull::findHorizon(int eye, int start, int iteration, std::vector<int> *visible,
+        std::vector<HorizonEdge> *horizon) {
+    // depth first, crossing edges in counter-clockwise order so the horizon comes out as a
+    // connected loop
+    struct Frame {
+        int face, firstEdge, edgesLeft;
+    };
+    std::vector<Frame> stack;
+    faces[start].visited = iteration;
+    visible->push_back(start);
+    stack.push_back({start, 0, 3});
+    while (!stack.empty()) {
+        Frame &frame = stack.back();
+        if (frame.edgesLeft == 0) {
+            stack.pop_back();
+            continue;
+        }
+        int edge = frame.firstEdge;
+        frame.firstEdge = (frame.firstEdge + 1) % 3;
+        frame.edgesLeft--;
+        int faceIndex = frame.face;
+        int neighbor = faces[faceIndex].adjacent[edge];
+        if (faces[neighbor].visited == iteration)
+            continue;
+        int back = 0; // edge of neighbor leading back
+        while (faces[neighbor].adjacent[back] != faceIndex)
+            back++;
+        if (distance(faces[neighbor], eye) > tolerance) {
+            faces[neighbor].visited = iteration;
+            visible->push_back(neighbor);
+            stack.push_back({neighbor, (back + 1) % 3, 2}); // invalidates frame
+        } else {
+            const HullFace &face = faces[faceIndex];
+            horizon->push_back({face.verts[edge], face.verts[(edge + 1) % 3], neighbor, back});
+        }
+    }
+}
+
+bool QuickHull::build() {
+    int simplex[4] = {-1, -1, -1, -1};
+    if (points.size() < 4 || !initialSimplex(simplex))
+        return false;
+    int s0 = simplex[0], s1 = simplex[1], s2 = simplex[2], s3 = simplex[3];
+    addFace(s0, s1, s2);
+    addFace(s1, s0, s3);
+    addFace(s2, s1, s3);
+    addFace(s0, s2, s3);
+    // across edge i of each face
+    int adjacency[4][3] = {{1, 2, 3}, {0, 3, 2}, {0, 1, 3}, {0, 2, 1}};
+    for (int f = 0; f < 4; f++) {
+        for (int e = 0; e < 3; e++)
+            faces[f].adjacent[e] = adjacency[f][e];
+    }
+    std::vector<ConflictPoint> allPoints;
+    allPoints.reserve(points.size());
+    for (int i = 0; i < (int)points.size(); i++) {
+        if (i != s0 && i != s1 && i != s2 && i != s3)
+            allPoints.push_back({points[i], i});
+    }
+    assignConflicts(allPoints, {0, 1, 2, 3});
+
+    std::vector<int> pending = {0, 1, 2, 3}; // faces which may have conflicts
+    std::vector<int> visible, newFaces;
+    std::vector<ConflictPoint> orphans;
+    std::vector<HorizonEdge> horizon;
+    int iteration = 0;
+    while (!pending.empty()) {
+        int start = pending.back();
+        pending.pop_back();
+        if (!faces[start].alive || faces[start].conflicts.empty())
+            continue;
+        int eye = faces[start].farthest;
+
+        visible.clear();
+        horizon.clear();
+        findHorizon(eye, start, iteration++, &visible, &horizon);
+
+        // cone of new faces from the horizon to the eye
+        orphans.clear();
+        for (int f : visible) {
+            for (auto &p : faces[f].conflicts) {
+                if (p.index != eye)
+                    orphans.push_back(p);
+            }
+        }
+        newFaces.clear();
+        for (auto &edge : horizon)
+            newFaces.push_back(addFace(edge.from, edge.to, eye));
+        for (size_t i = 0; i < horizon.size(); i++) {
+            HullFace &face = faces[newFaces[i]];
+            face.adjacent[0] = horizon[i].outside;
+            faces[horizon[i].outside].adjacent[horizon[i].outsideEdge] = newFaces[i];
+            face.adjacent[1] = newFaces[(i + 1) % horizon.size()];
+            face.adjacent[2] = newFaces[(i + horizon.size() - 1) % horizon.size()];
+        }
+        // after the new faces, so they don't reuse a face that is still being read
+        for (int f : visible) {
+            faces[f].alive = false;
+            freeFaces.push_back(f);
+        }
+        assignConflicts(orphans, newFaces);
+        for (int f : newFaces) {
+            if (!faces[f].conflicts.empty())
+                pending.push_back(f);
+        }
+    }
+    return true;
+}
+
+bool convexHull(Surface *surface, const std::vector<glm::vec3> &points, float tolerance) {
+    if (tolerance <= 0) {
+        glm::vec3 maxAbs(0);
+        for (auto &p : points)
+            maxAbs = glm::max(maxAbs, glm::abs(p));
+        tolerance = 3 * FLT_EPSILON * (maxAbs.x + maxAbs.y + maxAbs.z);
+    }
+    QuickHull hull(points, tolerance);
+    if (!hull.build()) {
+        wprintf(L"Points don't span a volume!\n");
+        return false;
+    }
+    auto &faces = hull.faces;
+
+    // flood fill coplanar groups, compared against the plane of the first face in the group
+    std::vector<int> group(faces.size(), -1), queue;
+    int numGroups = 0;
+    for (int f = 0; f < (int)faces.size(); f++) {
+        if (!faces[f].alive || group[f] >= 0)
+            continue;
+        const HullFace &seed = faces[f];
+        int g = numGroups++;
+        group[f] = g;
+        queue.assign(1, f);
+        while (!queue.empty()) {
+            int current = queue.back();
+            queue.pop_back();
+            for (int n : faces[current].adjacent) {
+                if (group[n] >= 0 || glm::dot(faces[n].normal, seed.normal) <= 0)
+                    continue;
+                bool coplanar = true;
+                for (int v : faces[n].verts) {
+                    if (glm::abs(hull.distance(seed, v)) > tolerance)
+                        coplanar = false;
+                }
+                if (coplanar) {
+                    group[n] = g;
+                    queue.push_back(n);
+                }
+            }
+        }
+    }
+    auto isBoundary = [&](int f, int e) { return group[faces[f].adjacent[e]] != group[f]; };
+
+    // boundary loop of each group: the next boundary edge is found by turning around the end
+    // vertex inside the group
+    // loops are stored back to back, loopSize 0 means the group has no face of its own
+    std::vector<std::pair<int, int>> loopEdges; // (face, edge)
+    std::vector<size_t> loopStart(numGroups, 0);
+    std::vector<int> loopSize(numGroups, 0), boundaryEdges(numGroups, 0);
+    loopEdges.reserve(faces.size());
+    for (int f = 0; f < (int)faces.size(); f++) {
+        if (!faces[f].alive)
+            continue;
+        for (int e = 0; e < 3; e++) {
+            if (!isBoundary(f, e))
+                continue;
+            int g = group[f];
+            boundaryEdges[g]++;
+            if (loopSize[g])
+                continue;
+            loopStart[g] = loopEdges.size();
+            int lf = f, le = e;
+            do {
+                loopEdges.push_back({lf, le});
+                le = (le + 1) % 3;
+                while (!isBoundary(lf, le)) {
+                    int n = faces[lf].adjacent[le];
+                    int back = 0;
+                    while (faces[n].adjacent[back] != lf)
+                        back++;
+                    lf = n;
+                    le = (back + 1) % 3;
+                }
+            } while (lf != f || le != e);
+            loopSize[g] = (int)(loopEdges.size() - loopStart[g]);
+        }
+    }
+    auto loopVert = [&](int g, int i) {
+        auto &edge = loopEdges[loopStart[g] + i];
+        return faces[edge.first].verts[edge.second];
+    };
+    // nearly coplanar regions can have holes or touch themselves, which would not make a
+    // simple polygon. leave those as triangles
+    std::vector<int> seen(points.size(), -1);
+    bool split = false;
+    for (int g = 0; g < numGroups; g++) {
+        bool simple = loopSize[g] == boundaryEdges[g];
+        for (int i = 0; i < loopSize[g]; i++) {
+            int v = loopVert(g, i);
+            if (seen[v] == g)
+                simple = false;
+            seen[v] = g;
+        }
+        if (!simple) {
+            loopSize[g] = 0;
+            split = true;
+        }
+    }
+    if (split) {
+        for (int f = 0; f < (int)faces.size(); f++) {
+            if (faces[f].alive && !loopSize[group[f]]) {
+                group[f] = numGroups++;
+                loopStart.push_back(loopEdges.size());
+                loopSize.push_back(3);
+                for (int e = 0; e < 3; e++)
+                    loopEdges.push_back({f, e});
+            }
+        }
+    }
+
+    // vertices with only two boundary edges leaving them are in the middle of a straight edge,
+    // and can be left out, unless that would leave a face with less than three sides
+    std::vector<char> keep(points.size(), 0);
+    std::vector<int> degree(points.size(), 0);
+    for (int g = 0; g < numGroups; g++) {
+        for (int i = 0; i < loopSize[g]; i++)
+            degree[loopVert(g, i)]++;
+    }
+    for (size_t v = 0; v < points.size(); v++)
+        keep[v] = degree[v] > 2;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int g = 0; g < numGroups; g++) {
+            int kept = 0;
+            for (int i = 0; i < loopSize[g]; i++)
+                kept += keep[loopVert(g, i)];
+            if (loopSize[g] && kept < 3) {
+                for (int i = 0; i < loopSize[g]; i++)
+                    keep[loopVert(g, i)] = 1;
+                changed = true;
+            }
+        }
+    }
+    std::vector<int> faceSizes, faceVerts;
+    for (int g = 0; g < numGroups; g++) {
+        if (!loopSize[g])
+            continue;
+        size_t start = faceVerts.size();
+        for (int i = 0; i < loopSize[g]; i++) {
+            int v = loopVert(g, i);
+            if (keep[v])
+                faceVerts.push_back(v);
+        }
+        faceSizes.push_back((int)(faceVerts.size() - start));
+    }
+    return buildSurface(surface, points, faceSizes, faceVerts);
+}
+
+} // namespace
@@ -0,0 +1,16 @@
+#pragma once
+#include <common.h>
+
+#include "surface.h"
+#include <vector>
+#include <glm/glm/vec3.hpp>
+
+namespace winged {
+
+// convex hull of a point cloud (quickhull), appended to the surface. adjacent triangles which
+// lie in the same plane (within tolerance) are merged into a single n-gon face.
+// tolerance <= 0 picks one from the size and precision of the input.
+// returns false if the points don't span a volume
+bool convexHull(Surface *surface, const std::vector<glm::vec3> &points, float tolerance = 0);
+
+} // namespace
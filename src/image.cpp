@@ -0,0 +1,458 @@
+#include "image.h"
+#include "inflate.h"
+#include <cstdio>
+#include <cstring>
+#include <cwchar>
+#include <utility>
+
+namespace winged {
+
+namespace {
+
+const uint8_t PNG_SIGNATURE[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+const uint64_t MAX_PIXELS = 1 << 28;
+
+// from a file or memory
+class Reader {
+public:
+    Reader(FILE *file) : file(file) {}
+    Reader(const uint8_t *data, size_t size) : data(data), size(size) {}
+
+    size_t read(void *dst, size_t count) {
+        if (file) {
+            count = fread(dst, 1, count, file);
+        } else {
+            if (count > size - pos)
+                count = size - pos;
+            if (count)
+                memcpy(dst, data + pos, count);
+        }
+        pos += count;
+        return count;
+    }
+    bool readAll(void *dst, size_t count) {
+        return read(dst, count) == count;
+    }
+    bool skip(size_t count) {
+        uint8_t buffer[1024];
+        while (count) {
+            size_t n = count < sizeof(buffer) ? count : sizeof(buffer);
+            if (!readAll(buffer, n))
+                return false;
+            count -= n;
+        }
+        return true;
+    }
+    size_t position() const { return pos; }
+
+private:
+    FILE *file = nullptr;
+    const uint8_t *data = nullptr;
+    size_t size = 0, pos = 0;
+};
+
+uint16_t readU16LE(const uint8_t *p) {
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+uint32_t readU32LE(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+uint32_t readU32BE(const uint8_t *p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | (uint32_t)p[3];
+}
+
+bool allocate(Image *image, int64_t width, int64_t height) {
+    if (width <= 0 || height <= 0 || (uint64_t)width * (uint64_t)height > MAX_PIXELS) {
+        wprintf(L"Invalid image size!\n");
+        return false;
+    }
+    image->width = (int)width;
+    image->height = (int)height;
+    image->pixels.assign((size_t)width * (size_t)height * 4, 0);
+    return true;
+}
+
+bool truncated() {
+    wprintf(L"Image file is truncated!\n");
+    return false;
+}
+
+bool unsupported() {
+    wprintf(L"Unsupported image format!\n");
+    return false;
+}
+
+// the first 8 bytes have already been read to detect the format
+bool loadBmp(Image *image, Reader *reader) {
+    uint8_t rest[6], info[124];
+    if (!reader->readAll(rest, 6) || !reader->readAll(info, 4))
+        return truncated();
+    uint32_t dataOffset = readU32LE(rest + 2);
+    uint32_t infoSize = readU32LE(info);
+    if (infoSize < 40 || infoSize > sizeof(info))
+        return unsupported();
+    if (!reader->readAll(info + 4, infoSize - 4))
+        return truncated();
+    int32_t width = (int32_t)readU32LE(info + 4), height = (int32_t)readU32LE(info + 8);
+    int bitCount = readU16LE(info + 14);
+    uint32_t compression = readU32LE(info + 16), colorsUsed = readU32LE(info + 32);
+    if (compression != 0 || (bitCount != 8 && bitCount != 24 && bitCount != 32))
+        return unsupported();
+    bool topDown = height < 0;
+    if (topDown)
+        height = -height;
+    if (!allocate(image, width, height))
+        return false;
+
+    uint8_t palette[256 * 4] = {}; // indices past colorsUsed are black
+    if (bitCount == 8) {
+        if (colorsUsed == 0 || colorsUsed > 256)
+            colorsUsed = 256;
+        if (!reader->readAll(palette, colorsUsed * 4))
+            return truncated();
+    }
+    if (reader->position() > dataOffset || !reader->skip(dataOffset - reader->position()))
+        return truncated();
+
+    size_t stride = ((size_t)width * bitCount + 31) / 32 * 4;
+    std::vector<uint8_t> row(stride);
+    for (int y = 0; y < height; y++) {
+        if (!reader->readAll(row.data(), stride))
+            return truncated();
+        uint8_t *dst = image->pixel(0, topDown ? height - 1 - y : y);
+        for (int x = 0; x < width; x++, dst += 4) {
+            const uint8_t *src = bitCount == 8 ? &palette[row[x] * 4] : &row[x * (bitCount / 8)];
+            // BGR order, and the fourth byte of 32 bit pixels is unused
+            dst[0] = src[2];
+            dst[1] = src[1];
+            dst[2] = src[0];
+            dst[3] = 255;
+        }
+    }
+    return true;
+}
+
+// start is the 8 bytes already read to detect the format
+bool loadTga(Image *image, Reader *reader, const uint8_t *start) {
+    uint8_t header[18];
+    memcpy(header, start, 8);
+    if (!reader->readAll(header + 8, 10))
+        return truncated();
+    int idLength = header[0], mapType = header[1], type = header[2];
+    int mapFirst = readU16LE(header + 3), mapLength = readU16LE(header + 5), mapBits = header[7];
+    int width = readU16LE(header + 12), height = readU16LE(header + 14), depth = header[16];
+    bool topDown = header[17] & 0x20;
+    bool rle = type & 8;
+    type &= ~8;
+
+    bool valid;
+    if (type == 1)
+        valid = mapType == 1 && depth == 8 && (mapBits == 24 || mapBits == 32);
+    else if (type == 2)
+        valid = depth == 24 || depth == 32;
+    else if (type == 3)
+        valid = depth == 8;
+    else
+        valid = false;
+    if (!valid)
+        return unsupported();
+    if (!allocate(image, width, height) || !reader->skip(idLength))
+        return false;
+
+    std::vector<uint8_t> colorMap;
+    if (mapType == 1) {
+        colorMap.resize((size_t)mapLength * ((mapBits + 7) / 8));
+        if (!reader->readAll(colorMap.data(), colorMap.size()))
+            return truncated();
+    }
+
+    // convert one pixel as stored in the file (BGR order) to RGBA
+    int pixelSize = depth / 8;
+    auto convert = [&](const uint8_t *src, uint8_t *dst) {
+        if (type == 1) {
+            int index = src[0] - mapFirst;
+            if (index < 0 || index >= mapLength) {
+                memset(dst, 0, 4);
+                return;
+            }
+            src = &colorMap[(size_t)index * (mapBits / 8)];
+            dst[3] = mapBits == 32 ? src[3] : 255;
+        } else if (type == 3) {
+            dst[0] = dst[1] = dst[2] = src[0];
+            dst[3] = 255;
+            return;
+        } else {
+            dst[3] = depth == 32 ? src[3] : 255;
+        }
+        dst[0] = src[2];
+        dst[1] = src[1];
+        dst[2] = src[0];
+    };
+
+    // run length packets may continue from one row to the next
+    int packetLeft = 0;
+    bool repeat = false;
+    uint8_t value[4];
+    std::vector<uint8_t> row((size_t)width * pixelSize);
+    for (int y = 0; y < height; y++) {
+        uint8_t *dst = image->pixel(0, topDown ? height - 1 - y : y);
+        if (!rle) {
+            if (!reader->readAll(row.data(), row.size()))
+                return truncated();
+            for (int x = 0; x < width; x++)
+                convert(&row[(size_t)x * pixelSize], dst + x * 4);
+            continue;
+        }
+        for (int x = 0; x < width; x++) {
+            if (packetLeft == 0) {
+                uint8_t packet;
+                if (!reader->readAll(&packet, 1))
+                    return truncated();
+                repeat = packet & 0x80;
+                packetLeft = (packet & 0x7f) + 1;
+                if (repeat && !reader->readAll(value, pixelSize))
+                    return truncated();
+            }
+            if (!repeat && !reader->readAll(value, pixelSize))
+                return truncated();
+            convert(value, dst + x * 4);
+            packetLeft--;
+        }
+    }
+    return true;
+}
+
+// Paeth predictor from the PNG spec
+uint8_t paeth(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = p > a ? p - a : a - p, pb = p > b ? p - b : b - p, pc = p > c ? p - c : c - p;
+    if (pa <= pb && pa <= pc)
+        return (uint8_t)a;
+    return (uint8_t)(pb <= pc ? b : c);
+}
+
+bool unfilter(uint8_t *row, const uint8_t *prev, size_t stride, int bpp, int filter) {
+    switch (filter) {
+        case 0:
+            return true;
+        case 1:
+            for (size_t i = bpp; i < stride; i++)
+                row[i] += row[i - bpp];
+            return true;
+        case 2:
+            for (size_t i = 0; i < stride; i++)
+                row[i] += prev[i];
+            return true;
+        case 3:
+            for (size_t i = 0; i < stride; i++)
+                row[i] += (uint8_t)(((i >= (size_t)bpp ? row[i - bpp] : 0) + prev[i]) / 2);
+            return true;
+        case 4:
+            for (size_t i = 0; i < stride; i++) {
+                if (i < (size_t)bpp)
+                    row[i] += prev[i];
+                else
+                    row[i] += paeth(row[i - bpp], prev[i], prev[i - bpp]);
+            }
+            return true;
+    }
+    return false;
+}
+
+bool loadPng(Image *image, Reader *reader) {
+    uint8_t chunkHeader[8];
+    auto nextChunk = [&](uint32_t *length) {
+        if (!reader->readAll(chunkHeader, 8))
+            return false;
+        *length = readU32BE(chunkHeader);
+        return true;
+    };
+    auto isChunk = [&](const char *type) {
+        return memcmp(chunkHeader + 4, type, 4) == 0;
+    };
+    auto invalid = []() {
+        wprintf(L"Invalid PNG file!\n");
+        return false;
+    };
+
+    uint32_t length;
+    uint8_t ihdr[13];
+    if (!nextChunk(&length) || !isChunk("IHDR") || length != 13 || !reader->readAll(ihdr, 13)
+            || !reader->skip(4))
+        return invalid();
+    uint32_t width = readU32BE(ihdr), height = readU32BE(ihdr + 4);
+    int bitDepth = ihdr[8], colorType = ihdr[9];
+    if (ihdr[10] != 0 || ihdr[11] != 0)
+        return invalid();
+    if (ihdr[12] != 0)
+        return unsupported(); // interlaced
+    int channels;
+    switch (colorType) {
+        case 0: channels = 1; break; // gray
+        case 2: channels = 3; break; // RGB
+        case 3: channels = 1; break; // palette
+        case 4: channels = 2; break; // gray + alpha
+        case 6: channels = 4; break; // RGBA
+        default: return invalid();
+    }
+    bool lowDepth = bitDepth == 1 || bitDepth == 2 || bitDepth == 4;
+    if (!(bitDepth == 8 || (bitDepth == 16 && colorType != 3)
+            || (lowDepth && (colorType == 0 || colorType == 3))))
+        return invalid();
+    if (!allocate(image, width, height))
+        return false;
+
+    uint8_t palette[256 * 4];
+    memset(palette, 0, sizeof(palette));
+    for (int i = 0; i < 256; i++)
+        palette[i * 4 + 3] = 255;
+    while (true) {
+        if (!nextChunk(&length))
+            return truncated();
+        if (isChunk("IDAT"))
+            break;
+        if (isChunk("IEND"))
+            return invalid();
+        if (isChunk("PLTE") && length <= 256 * 3 && length % 3 == 0) {
+            uint8_t rgb[256 * 3];
+            if (!reader->readAll(rgb, length))
+                return truncated();
+            for (uint32_t i = 0; i < length / 3; i++)
+                memcpy(&palette[i * 4], &rgb[i * 3], 3);
+        } else if (isChunk("tRNS") && colorType == 3 && length <= 256) {
+            uint8_t alpha[256];
+            if (!reader->readAll(alpha, length))
+                return truncated();
+            for (uint32_t i = 0; i < length; i++)
+                palette[i * 4 + 3] = alpha[i];
+        } else if (!reader->skip(length)) {
+            return truncated();
+        }
+        if (!reader->skip(4)) // CRC
+            return truncated();
+    }
+
+    // data can be split over any number of consecutive IDAT chunks
+    uint32_t chunkLeft = length;
+    bool idatDone = false;
+    ReadFunc readIdat = [&](uint8_t *buffer, size_t size) -> size_t {
+        while (chunkLeft == 0) {
+            if (idatDone || !reader->skip(4) || !nextChunk(&chunkLeft) || !isChunk("IDAT")) {
+                idatDone = true;
+                return 0;
+            }
+        }
+        if (size > chunkLeft)
+            size = chunkLeft;
+        size = reader->read(buffer, size);
+        chunkLeft -= (uint32_t)size;
+        if (size == 0)
+            idatDone = true;
+        return size;
+    };
+    int bitsPerPixel = bitDepth * channels;
+    int bpp = (bitsPerPixel + 7) / 8; // filters work on whole bytes
+    size_t stride = ((size_t)width * bitsPerPixel + 7) / 8;
+    int sampleStep = bitDepth == 16 ? 2 : 1; // high byte of 16 bit samples
+    auto storeRow = [&](const uint8_t *row, uint32_t y) {
+        uint8_t *dst = image->pixel(0, height - 1 - y); // PNG is stored top down
+        for (uint32_t x = 0; x < width; x++, dst += 4) {
+            if (lowDepth) {
+                size_t bit = (size_t)x * bitDepth;
+                int shift = 8 - bitDepth - (int)(bit % 8);
+                int sample = (row[bit / 8] >> shift) & ((1 << bitDepth) - 1);
+                if (colorType == 3) {
+                    memcpy(dst, &palette[sample * 4], 4);
+                } else {
+                    dst[0] = dst[1] = dst[2] = (uint8_t)(sample * 255 / ((1 << bitDepth) - 1));
+                    dst[3] = 255;
+                }
+                continue;
+            }
+            const uint8_t *src = row + (size_t)x * channels * sampleStep;
+            auto sample = [&](int c) { return src[c * sampleStep]; };
+            switch (colorType) {
+                case 0:
+                    dst[0] = dst[1] = dst[2] = sample(0);
+                    dst[3] = 255;
+                    break;
+                case 2:
+                    dst[0] = sample(0);
+                    dst[1] = sample(1);
+                    dst[2] = sample(2);
+                    dst[3] = 255;
+                    break;
+                case 3:
+                    memcpy(dst, &palette[src[0] * 4], 4);
+                    break;
+                case 4:
+                    dst[0] = dst[1] = dst[2] = sample(0);
+                    dst[3] = sample(1);
+                    break;
+                case 6:
+                    for (int c = 0; c < 4; c++)
+                        dst[c] = sample(c);
+                    break;
+            }
+        }
+    };
+
+    // rows are unfiltered as soon as they are complete, only the previous one is kept.
+    // each starts with its filter type
+    std::vector<uint8_t> row(stride + 1), prevRow(stride + 1, 0);
+    size_t rowFilled = 0;
+    uint32_t y = 0;
+    WriteFunc writeRows = [&](const uint8_t *data, size_t size) {
+        while (size) {
+            size_t n = size < stride + 1 - rowFilled ? size : stride + 1 - rowFilled;
+            memcpy(&row[rowFilled], data, n);
+            rowFilled += n;
+            data += n;
+            size -= n;
+            if (rowFilled == stride + 1) {
+                if (!unfilter(&row[1], &prevRow[1], stride, bpp, row[0]))
+                    return invalid();
+                storeRow(&row[1], y++);
+                std::swap(row, prevRow);
+                rowFilled = 0;
+            }
+        }
+        return true;
+    };
+    return inflateZlib(readIdat, writeRows, (stride + 1) * height);
+}
+
+bool load(Image *image, Reader *reader) {
+    uint8_t header[8];
+    if (!reader->readAll(header, 8))
+        return truncated();
+    if (memcmp(header, PNG_SIGNATURE, 8) == 0)
+        return loadPng(image, reader);
+    if (header[0] == 'B' && header[1] == 'M')
+        return loadBmp(image, reader);
+    // TGA has no signature, the header is checked for a supported type instead
+    return loadTga(image, reader, header);
+}
+
+} // namespace
+
+bool loadImage(Image *image, const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        wprintf(L"Couldn't open file!\n");
+        return false;
+    }
+    Reader reader(file);
+    bool ok = load(image, &reader);
+    fclose(file);
+    return ok;
+}
+
+bool loadImage(Image *image, const uint8_t *data, size_t size) {
+    Reader reader(data, size);
+    return load(image, &reader);
+}
+
+} // namespace
@@ -0,0 +1,25 @@
+#pragma once
+#include <common.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace winged {
+
+// 8 bit RGBA. rows go from the bottom of the picture to the top, like OpenGL expects
+struct Image {
+    int width = 0, height = 0;
+    std::vector<uint8_t> pixels; // width * height * 4
+
+    uint8_t * pixel(int x, int y) { return &pixels[((size_t)y * width + x) * 4]; }
+    const uint8_t * pixel(int x, int y) const { return &pixels[((size_t)y * width + x) * 4]; }
+};
+
+// BMP (uncompressed 8, 24 or 32 bit), TGA (true color, grayscale or color mapped, optionally RLE)
+// or PNG (non-interlaced), detected from the contents. rows are decoded as they are read, the
+// file is never loaded in full. returns false if the format isn't supported
+bool loadImage(Image *image, const char *path);
+bool loadImage(Image *image, const uint8_t *data, size_t size); // eg. from a resource
+
+} // namespace
@@ -0,0 +1,358 @@
+#include "inflate.h"
+#include <cstring>
+#include <cwchar>
+#include <vector>
+
+namespace winged {
+
+namespace {
+
+const int MAX_BITS = 15;
+const int FAST_BITS = 9; // codes up to this length are decoded with one table lookup
+// output is kept in a ring twice the size of the deflate window, and passed on when half full.
+// so the unwritten part plus the longest back reference always fit
+const size_t WINDOW_SIZE = 65536, WINDOW_MASK = WINDOW_SIZE - 1, FLUSH_SIZE = 32768;
+
+const uint16_t LENGTH_BASE[] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43,
+    51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+const uint8_t LENGTH_EXTRA[] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4,
+    4, 4, 5, 5, 5, 5, 0};
+const uint16_t DIST_BASE[] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385,
+    513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+const uint8_t DIST_EXTRA[] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9,
+    10, 10, 11, 11, 12, 12, 13, 13};
+// order of the code length code lengths in a dynamic block header
+const uint8_t CLEN_ORDER[] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+// least significant bit first, as deflate packs everything except huffman codes
+class BitReader {
+public:
+    BitReader(const ReadFunc &read) : read(read) {}
+
+    // reading past the end of the input gives zeros, check overrun() afterwards
+    uint32_t peek(int count) {
+        while (numBits < count) {
+            if (pos == end && !refill()) {
+                padding += 8;
+                numBits += 8;
+                continue;
+            }
+            bits |= (uint64_t)buffer[pos++] << numBits;
+            numBits += 8;
+        }
+        return (uint32_t)(bits & ((1ull << count) - 1));
+    }
+    void consume(int count) {
+        bits >>= count;
+        numBits -= count;
+    }
+    uint32_t get(int count) {
+        uint32_t value = peek(count);
+        consume(count);
+        return value;
+    }
+    void alignToByte() {
+        consume(numBits % 8);
+    }
+    bool copyBytes(uint8_t *dst, size_t count) {
+        // whole bytes left in the bit buffer come first
+        for (; count && numBits >= 8; count--)
+            *dst++ = (uint8_t)get(8);
+        while (count) {
+            if (pos == end && !refill())
+                return false;
+            size_t n = count < end - pos ? count : end - pos;
+            memcpy(dst, buffer + pos, n);
+            pos += n;
+            dst += n;
+            count -= n;
+        }
+        return true;
+    }
+    bool overrun() const {
+        return padding > numBits;
+    }
+
+private:
+    const ReadFunc &read;
+    uint8_t buffer[4096];
+    size_t pos = 0, end = 0;
+    uint64_t bits = 0;
+    int numBits = 0;
+    int padding = 0; // zero bits made up past the end of the input
+
+    bool refill() {
+        pos = 0;
+        end = read(buffer, sizeof(buffer));
+        return end != 0;
+    }
+};
+
+class Huffman {
+public:
+    bool build(const uint8_t *lengths, int num) {
+        memset(counts, 0, sizeof(counts));
+        memset(fast, 0, sizeof(fast));
+        for (int i = 0; i < num; i++)
+            counts[lengths[i]]++;
+        counts[0] = 0;
+        int left = 1, offsets[MAX_BITS + 2] = {0, 0};
+        for (int len = 1; len <= MAX_BITS; len++) {
+            left = (left << 1) - counts[len];
+            if (left < 0)
+                return false; // over-subscribed. incomplete codes are allowed
+            offsets[len + 1] = offsets[len] + counts[len];
+        }
+        // canonical codes are assigned in order of length, then symbol
+        int code = 0, nextCode[MAX_BITS + 1];
+        for (int len = 1; len <= MAX_BITS; len++) {
+            code = (code + counts[len - 1]) << 1;
+            nextCode[len] = code;
+        }
+        for (int sym = 0; sym < num; sym++) {
+            int len = lengths[sym];
+            if (!len)
+                continue;
+            symbols[offsets[len]++] = (uint16_t)sym;
+            if (len > FAST_BITS)
+                continue;
+            // codes are stored first bit first, so the table is indexed by the reversed code
+            int reversed = 0;
+            for (int i = 0, c = nextCode[len]; i < len; i++, c >>= 1)
+                reversed = (reversed << 1) | (c & 1);
+            for (int i = reversed; i < (1 << FAST_BITS); i += 1 << len)
+                fast[i] = (uint16_t)((len << 12) | sym);
+            nextCode[len]++;
+        }
+        return true;
+    }
+
+    int decode(BitReader *bits) const {
+        uint16_t entry = fast[bits->peek(FAST_BITS)];
+        if (entry) {
+            bits->consume(entry >> 12);
+            return entry & 0xfff;
+        }
+        // one bit at a time, comparing against the first code of each length
+        uint32_t word = bits->peek(MAX_BITS);
+        int code = 0, first = 0, index = 0;
+        for (int len = 1; len <= MAX_BITS; len++) {
+            code |= (word >> (len - 1)) & 1;
+            int count = counts[len];
+            if (code - first < count) {
+                bits->consume(len);
+                return symbols[index + code - first];
+            }
+            index += count;
+            first = (first + count) << 1;
+            code <<= 1;
+        }
+        return -1;
+    }
+
+private:
+    uint16_t fast[1 << FAST_BITS]; // (length << 12) | symbol, or 0 for longer codes
+    uint16_t counts[MAX_BITS + 1];
+    uint16_t symbols[288]; // sorted by code
+};
+
+class Inflater {
+public:
+    Inflater(const ReadFunc &read, const WriteFunc &write, size_t outSize)
+        : bits(read), write(write), outSize(outSize), window(WINDOW_SIZE) {}
+
+    bool run() {
+        uint32_t cmf = bits.get(8), flg = bits.get(8);
+        if ((cmf & 0xf) != 8 || (cmf * 256 + flg) % 31 != 0 || (flg & 0x20))
+            return false; // not deflate, bad checksum or preset dictionary
+        bool final;
+        do {
+            final = bits.get(1);
+            uint32_t type = bits.get(2);
+            bool ok;
+            if (type == 0)
+                ok = storedBlock();
+            else if (type == 1)
+                ok = fixedBlock();
+            else if (type == 2)
+                ok = dynamicBlock();
+            else
+                ok = false;
+            if (!ok || bits.overrun())
+                return false;
+        } while (!final);
+        if (written != outSize || !flush())
+            return false;
+        bits.alignToByte();
+        uint32_t expected = bits.get(8) << 24;
+        expected |= bits.get(8) << 16;
+        expected |= bits.get(8) << 8;
+        expected |= bits.get(8);
+        return !bits.overrun() && ((adlerB << 16) | adlerA) == expected;
+    }
+
+private:
+    BitReader bits;
+    const WriteFunc &write;
+    size_t outSize, written = 0, flushed = 0; // total bytes decoded, and passed to write
+    std::vector<uint8_t> window; // ring buffer, byte i of the output is at i & WINDOW_MASK
+    uint32_t adlerA = 1, adlerB = 0;
+    Huffman lengthCodes, distCodes;
+
+public:
+    bool writeFailed = false; // stopped by write, which reports its own error
+private:
+
+    // pass on everything decoded so far
+    bool flush() {
+        while (flushed < written) {
+            size_t start = flushed & WINDOW_MASK, size = written - flushed;
+            if (size > WINDOW_SIZE - start)
+                size = WINDOW_SIZE - start; // wraps around, in two parts
+            updateAdler32(&window[start], size);
+            if (!write(&window[start], size)) {
+                writeFailed = true;
+                return false;
+            }
+            flushed += size;
+        }
+        return true;
+    }
+
+    bool storedBlock() {
+        bits.alignToByte();
+        uint32_t len = bits.get(16), nlen = bits.get(16);
+        if ((len ^ 0xffff) != nlen || len > outSize - written)
+            return false;
+        while (len) {
+            size_t start = written & WINDOW_MASK, size = len;
+            if (size > WINDOW_SIZE - start)
+                size = WINDOW_SIZE - start;
+            if (size > FLUSH_SIZE)
+                size = FLUSH_SIZE;
+            if (!bits.copyBytes(&window[start], size))
+                return false;
+            written += size;
+            len -= (uint32_t)size;
+            if (written - flushed >= FLUSH_SIZE && !flush())
+                return false;
+        }
+        return true;
+    }
+
+    bool fixedBlock() {
+        uint8_t lengths[288 + 30];
+        memset(lengths, 8, 144);
+        memset(lengths + 144, 9, 112);
+        memset(lengths + 256, 7, 24);
+        memset(lengths + 280, 8, 8);
+        memset(lengths + 288, 5, 30);
+        lengthCodes.build(lengths, 288);
+        distCodes.build(lengths + 288, 30);
+        return codes();
+    }
+
+    bool dynamicBlock() {
+        int numLengths = bits.get(5) + 257, numDists = bits.get(5) + 1, numClens = bits.get(4) + 4;
+        if (numLengths > 286 || numDists > 30)
+            return false;
+        uint8_t clens[19] = {0};
+        for (int i = 0; i < numClens; i++)
+            clens[CLEN_ORDER[i]] = (uint8_t)bits.get(3);
+        Huffman clenCodes;
+        if (!clenCodes.build(clens, 19))
+            return false;
+
+        // literal/length and distance lengths are one sequence, repeats can cross between them
+        uint8_t lengths[286 + 30];
+        int total = numLengths + numDists;
+        for (int i = 0; i < total;) {
+            int sym = clenCodes.decode(&bits);
+            if (sym < 0)
+                return false;
+            if (sym < 16) {
+                lengths[i++] = (uint8_t)sym;
+                continue;
+            }
+            uint8_t value = 0;
+            int repeat;
+            if (sym == 16) {
+                if (i == 0)
+                    return false;
+                value = lengths[i - 1];
+                repeat = 3 + bits.get(2);
+            } else if (sym == 17) {
+                repeat = 3 + bits.get(3);
+            } else {
+                repeat = 11 + bits.get(7);
+            }
+            if (i + repeat > total)
+                return false;
+            memset(lengths + i, value, repeat);
+            i += repeat;
+        }
+        if (!lengths[256])
+            return false; // no end of block code
+        return lengthCodes.build(lengths, numLengths)
+            && distCodes.build(lengths + numLengths, numDists) && codes();
+    }
+
+    bool codes() {
+        while (true) {
+            if (written - flushed >= FLUSH_SIZE && !flush())
+                return false;
+            int sym = lengthCodes.decode(&bits);
+            if (sym < 0 || bits.overrun())
+                return false;
+            if (sym < 256) {
+                if (written == outSize)
+                    return false;
+                window[written++ & WINDOW_MASK] = (uint8_t)sym;
+                continue;
+            }
+            if (sym == 256)
+                return true;
+            sym -= 257;
+            if (sym >= 29)
+                return false;
+            size_t len = LENGTH_BASE[sym] + bits.get(LENGTH_EXTRA[sym]);
+            int distSym = distCodes.decode(&bits);
+            if (distSym < 0 || distSym >= 30)
+                return false;
+            size_t dist = DIST_BASE[distSym] + bits.get(DIST_EXTRA[distSym]);
+            if (dist > written || len > outSize - written)
+                return false;
+            // one byte at a time, since the copy can wrap around the ring, and overlapping
+            // copies (dist < len) repeat the last dist bytes
+            for (size_t i = 0; i < len; i++, written++)
+                window[written & WINDOW_MASK] = window[(written - dist) & WINDOW_MASK];
+        }
+    }
+
+    void updateAdler32(const uint8_t *data, size_t size) {
+        for (size_t i = 0; i < size;) {
+            // largest run before b can overflow
+            size_t end = size - i < 5552 ? size : i + 5552;
+            for (; i < end; i++) {
+                adlerA += data[i];
+                adlerB += adlerA;
+            }
+            adlerA %= 65521;
+            adlerB %= 65521;
+        }
+    }
+};
+
+} // namespace
+
+bool inflateZlib(const ReadFunc &read, const WriteFunc &write, size_t outSize) {
+    Inflater inflater(read, write, outSize);
+    if (!inflater.run()) {
+        if (!inflater.writeFailed)
+            wprintf(L"Invalid compressed data!\n");
+        return false;
+    }
+    return true;
+}
+
+} // namespace
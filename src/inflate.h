@@ -0,0 +1,21 @@
+#pragma once
+#include <common.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace winged {
+
+// fill buffer with up to size bytes of compressed data. returns 0 at the end of the input
+using ReadFunc = std::function<size_t(uint8_t *buffer, size_t size)>;
+// take the next size bytes of decompressed data. return false to stop with an error
+using WriteFunc = std::function<bool(const uint8_t *data, size_t size)>;
+
+// decompress a zlib stream (RFC 1950/1951). both sides are streamed: compressed data is pulled
+// in small blocks as it is needed, and output is passed on in blocks of up to 32 KB, keeping
+// only the 32 KB window that back references can reach. the output must be exactly outSize
+// bytes, otherwise returns false
+bool inflateZlib(const ReadFunc &read, const WriteFunc &write, size_t outSize);
+
+} // namespace
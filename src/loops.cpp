@@ -0,0 +1,105 @@
+#include "loops.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <glm/glm/geometric.hpp>
+
+namespace winged {
+
+namespace {
+
+// each step is reversible, so a path can only come back around to where it started
+
+// the edge across the vertex at the end of edge, or null. the vertex has four edges if going
+// around it both ways from edge meets at the same edge. the two sides don't depend on each
+// other, so their loads can overlap
+HEdge * loopStep(HEdge *edge) {
+    HEdge *across = edge->next->twin->next;
+    return edge->twin->prev->twin->prev->twin == across ? across : nullptr;
+}
+
+// the edge across the face of edge, or null
+HEdge * ringStep(HEdge *edge) {
+    HEdge *opposite = edge->next->next;
+    return opposite->next->next == edge ? opposite->twin : nullptr;
+}
+
+bool walk(HEdge *start, HEdge * (*step)(HEdge *), std::vector<HEdge *> *edges) {
+    size_t begin = edges->size();
+    edges->push_back(start);
+    for (HEdge *edge = step(start); edge; edge = step(edge)) {
+        if (edge == start || edge == start->twin)
+            return true;
+        edges->push_back(edge);
+    }
+    // go the other way from start, then move those edges in front
+    size_t end = edges->size();
+    for (HEdge *edge = step(start->twin); edge; edge = step(edge)) {
+        if (edge == start || edge == start->twin)
+            break;
+        edges->push_back(edge->twin);
+    }
+    std::reverse(edges->begin() + end, edges->end());
+    std::rotate(edges->begin() + begin, edges->begin() + end, edges->end());
+    return false;
+}
+
+} // namespace
+
+bool edgeLoop(HEdge *edge, std::vector<HEdge *> *edges) {
+    return walk(edge, loopStep, edges);
+}
+
+bool edgeRing(HEdge *edge, std::vector<HEdge *> *edges) {
+    return walk(edge, ringStep, edges);
+}
+
+bool shortestPath(Surface *surface, Vertex *a, Vertex *b, std::vector<HEdge *> *edges) {
+    struct Entry {
+        float dist;
+        Vertex *vertex;
+        bool operator>(const Entry &other) const { return dist > other.dist; }
+    };
+    // indexed by Vertex::index, cheaper than a hash map even when only a few are visited
+    std::vector<float> dist(surface->vertices.size(), INFINITY);
+    std::vector<HEdge *> via(surface->vertices.size(), nullptr); // the edge arriving at each
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> front;
+    dist[a->index] = 0;
+    front.push({0, a});
+    while (!front.empty()) {
+        Entry entry = front.top();
+        front.pop();
+        if (entry.vertex == b)
+            break;
+        if (entry.dist > dist[entry.vertex->index])
+            continue; // stale
+        for (ITER_VERTEX_EDGES(entry.vertex, vertEdge)) {
+            Vertex *other = vertEdge->twin->vert;
+            float otherDist = entry.dist + glm::distance(entry.vertex->pos, other->pos);
+            if (otherDist < dist[other->index]) {
+                dist[other->index] = otherDist;
+                via[other->index] = vertEdge;
+                front.push({otherDist, other});
+            }
+        }
+    }
+    if (a != b && !via[b->index])
+        return false;
+    size_t begin = edges->size();
+    for (Vertex *vert = b; vert != a; vert = via[vert->index]->vert)
+        edges->push_back(via[vert->index]);
+    std::reverse(edges->begin() + begin, edges->end());
+    return true;
+}
+
+void selectEdgeVertices(const std::vector<HEdge *> &edges,
+        std::unordered_set<Vertex *> *vertices) {
+    vertices->reserve(vertices->size() + edges.size() + 1);
+    for (HEdge *edge : edges) {
+        vertices->insert(edge->vert);
+        vertices->insert(edge->twin->vert);
+    }
+}
+
+} // namespace
@@ -0,0 +1,27 @@
+#pragma once
+#include <common.h>
+
+#include "surface.h"
+#include <unordered_set>
+#include <vector>
+
+namespace winged {
+
+// edges are appended in path order. each returns true if the path closed back on itself and
+// false if it stopped early, in which case it's extended both ways from the given edge.
+
+// continues straight across vertices with four edges, stops at poles (any other number of
+// edges). the edges point along the loop. O(k) for k edges in the loop
+bool edgeLoop(HEdge *edge, std::vector<HEdge *> *edges);
+// continues across quads to the opposite edge, stops at faces with any other number of sides.
+// the edges all point the same way as the given one. O(k)
+bool edgeRing(HEdge *edge, std::vector<HEdge *> *edges);
+// fewest total length, from a to b. false if b can't be reached. Dijkstra, stops as soon as b
+// is reached so it only visits vertices closer to a than b. the edges point from a to b
+bool shortestPath(Surface *surface, Vertex *a, Vertex *b, std::vector<HEdge *> *edges);
+
+// add the vertices of all the edges to a selection
+void selectEdgeVertices(const std::vector<HEdge *> &edges,
+    std::unordered_set<Vertex *> *vertices);
+
+} // namespace
@@ -1,11 +1,24 @@
 #include "surface.h"
+#include "operations.h"
+#include "oplog.h"
+#include "loops.h"
+#include "memusage.h"
+#include "modifiers.h"
 #include "picking.h"
+#include "polygon.h"
+#include "scene.h"
+#include "smooth.h"
+#include "softselect.h"
+#include "snapping.h"
+#include "symmetry.h"
+#include "texcache.h"
+#include "weld.h"
 #include "resource.h"
+#include <cstring>
 #include <unordered_set>
 #include <windows.h>
 #include <windowsx.h>
 #include <gl/GL.h>
-#include <gl/GLU.h>
 #include <glm/glm/gtc/matrix_transform.hpp>
 #include <glm/glm/gtc/type_ptr.hpp>
 #include <glm/glm/gtx/rotate_vector.hpp>
@@ -13,13 +26,26 @@
 #pragma comment(lib, "User32.lib")
 #pragma comment(lib, "Gdi32.lib")
 #pragma comment(lib, "Opengl32.lib")
-#pragma comment(lib, "Glu32.lib")
 
 using namespace winged;
 
-static Surface theSurface;
+static std::shared_ptr<Mesh> editMesh = std::make_shared<Mesh>();
+static Surface &theSurface = editMesh->surface;
+static Scene scene; // editMesh and instances of it
+static ModifierStack modifiers; // previewed on editMesh, evaluated in the background
+static bool modifiersDirty = false; // theSurface changed since the last evaluation started
+static const UINT_PTR MODIFIER_TIMER = 1;
+static OpLog opLog; // every change to theSurface goes through here
 static HEdge *selectedEdge, *storedEdge = nullptr;
 static std::unordered_set<Vertex *>selectedVertices;
+static bool proportional = false;
+static SoftSelection softSelection;
+static bool symmetric = false;
+static Symmetry symmetry;
+static SnapIndex snapIndex; // kept between drags, refit as vertices move
+static std::unordered_set<Vertex *> dragMoving; // left out of snapping, empty if not dragging
+static Vertex *dragAnchor = nullptr; // snapped to targets, other vertices follow
+static glm::vec3 dragTarget; // unsnapped position of dragAnchor
 static int lastMouseX, lastMouseY;
 static float rotX = 0, rotY = 0;
 
@@ -27,443 +53,141 @@ static glm::vec2 windowDim;
 static glm::mat4 projMat, mvMat;
 
 static Picker picker;
-static GLUtesselator *tess;
-
-void linkTwins(HEdge *edge1, HEdge *edge2) {
-    edge1->twin = edge2;
-    edge2->twin = edge1;
-}
-
-void linkNext(HEdge *prev, HEdge *next) {
-    prev->next = next;
-    next->prev = prev;
-}
-
-void makeCube(Surface *surface) {
-    for (int i = 0; i < 8; i++) {
-        Vertex *vertex = surface->newVertex();
-        vertex->pos.x = (i & 0x1) ? 1.0f : -1.0f;
-        vertex->pos.y = (i & 0x2) ? 1.0f : -1.0f;
-        vertex->pos.z = (i & 0x4) ? 1.0f : -1.0f;
+static TextureCache textureCache;
+static const char *texturePath = nullptr; // null for the built in texture
+
+// after an operation that can't be mirrored
+void breakSymmetry() {
+    if (symmetric) {
+        symmetric = false;
+        symmetry.clear();
+        wprintf(L"Symmetry off\n");
     }
-
-    HEdge *edges[6][4]; // counter-clockwise order
-    for (int i = 0; i < 6; i++) {
-        Face *face = surface->newFace();
-        for (int j = 0; j < 4; j++) {
-            HEdge *edge = surface->newEdge();
-            edges[i][j] = edge;
-            edge->face = face;
-        }
-        face->edge = edges[i][0];
-        for (int j = 0; j < 3; j++)
-            linkNext(edges[i][j], edges[i][j + 1]);
-        linkNext(edges[i][3], edges[i][0]);
-    }
-
-    // normal (-1, 0, 0)         0bZYX
-    edges[0][0]->vert = surface->vertices[0b000].get();  linkTwins(edges[0][0], edges[2][3]);
-    edges[0][1]->vert = surface->vertices[0b100].get();  linkTwins(edges[0][1], edges[5][3]);
-    edges[0][2]->vert = surface->vertices[0b110].get();
-    edges[0][3]->vert = surface->vertices[0b010].get();
-    // normal (1, 0, 0)
-    edges[1][0]->vert = surface->vertices[0b001].get();  linkTwins(edges[1][0], edges[4][2]);
-    edges[1][1]->vert = surface->vertices[0b011].get();  linkTwins(edges[1][1], edges[3][2]);
-    edges[1][2]->vert = surface->vertices[0b111].get();
-    edges[1][3]->vert = surface->vertices[0b101].get();
-    // normal (0, -1, 0)
-    edges[2][0]->vert = surface->vertices[0b000].get();  linkTwins(edges[2][0], edges[4][3]);
-    edges[2][1]->vert = surface->vertices[0b001].get();  linkTwins(edges[2][1], edges[1][3]);
-    edges[2][2]->vert = surface->vertices[0b101].get();
-    edges[2][3]->vert = surface->vertices[0b100].get();
-    // normal (0, 1, 0)
-    edges[3][0]->vert = surface->vertices[0b010].get();  linkTwins(edges[3][0], edges[0][2]);
-    edges[3][1]->vert = surface->vertices[0b110].get();  linkTwins(edges[3][1], edges[5][2]);
-    edges[3][2]->vert = surface->vertices[0b111].get();
-    edges[3][3]->vert = surface->vertices[0b011].get();
-    // normal (0, 0, -1)
-    edges[4][0]->vert = surface->vertices[0b000].get();  linkTwins(edges[4][0], edges[0][3]);
-    edges[4][1]->vert = surface->vertices[0b010].get();  linkTwins(edges[4][1], edges[3][3]);
-    edges[4][2]->vert = surface->vertices[0b011].get();
-    edges[4][3]->vert = surface->vertices[0b001].get();
-    // normal (0, 0, 1)
-    edges[5][0]->vert = surface->vertices[0b100].get();  linkTwins(edges[5][0], edges[2][2]);
-    edges[5][1]->vert = surface->vertices[0b101].get();  linkTwins(edges[5][1], edges[1][2]);
-    edges[5][2]->vert = surface->vertices[0b111].get();
-    edges[5][3]->vert = surface->vertices[0b110].get();
-
-    for (int i = 4; i < 6; i++)
-        for (int j = 0; j < 4; j++)
-            edges[i][j]->vert->edge = edges[i][j];
-
-    selectedEdge = surface->edges[0].get();
 }
 
-// for debugging only!!
-bool validateSurface(Surface *surface) {
-    const uint32_t UNINITIALIZED = 0xCDCDCDCD; // used by MSVC debugging runtime
-    const float UNINITIALIZED_FLOAT = *(float *)&UNINITIALIZED;
-
-    bool valid = true;
-    std::unordered_set<Vertex *> vertices;
-    std::unordered_set<Face *> faces;
-    std::unordered_set<HEdge *> edges;
-    for (auto &v : surface->vertices)
-        vertices.insert(v.get());
-    if (vertices.size() < surface->vertices.size()) {
-        wprintf(L"Surface contains duplicate vertex entries!\n");
-        valid = false;
-    }
-    for (auto &f : surface->faces)
-        faces.insert(f.get());
-    if (faces.size() < surface->faces.size()) {
-        wprintf(L"Surface contains duplicate face entries!\n");
-        valid = false;
-    }
-    for (auto &e : surface->edges)
-        edges.insert(e.get());
-    if (edges.size() < surface->edges.size()) {
-        wprintf(L"Surface contains duplicate edge entries!\n");
-        valid = false;
-    }
-
-    for (auto &v : surface->vertices) {
-        if (!edges.count(v->edge)) {
-            wprintf(L"Vertex has invalid edge reference!\n");
-            valid = false;
-        } else {
-            for (ITER_VERTEX_EDGES(v, vertEdge)) {
-                if (vertEdge->vert != v.get()) {
-                    wprintf(L"Edge attached to vertex does not reference vertex!\n");
-                    valid = false;
-                }
-            }
-        }
-        if (v->pos.x == UNINITIALIZED_FLOAT || v->pos.y == UNINITIALIZED_FLOAT
-                || v->pos.z == UNINITIALIZED_FLOAT) {
-            wprintf(L"Vertex position is uninitialized!\n");
-            valid = false;
-        } else {
-            glm::vec3 absPos = glm::abs(v->pos);
-            if (absPos.x > 1000000 || absPos.y > 1000000 || absPos.z > 1000000)
-                wprintf(L"Vertex has a very large coordinate, may be uninitialized! (%f, %f, %f)\n",
-                    v->pos.x, v->pos.y, v->pos.z);
-        }
-    }
-
-    for (auto &f : surface->faces) {
-        if (!edges.count(f->edge)) {
-            wprintf(L"Face has invalid edge reference!\n");
-            valid = false;
-        } else {
-            for (ITER_FACE_EDGES(f, faceEdge)) {
-                if (faceEdge->face != f.get()) {
-                    wprintf(L"Edge attached to face does not reference face!\n");
-                    valid = false;
-                }
-            }
-            if (f->edge->next->next == f->edge) {
-                wprintf(L"Face only has two edges!\n");
-                valid = false;
-            }
-        }
-    }
+// after every change to theSurface
+void surfaceChanged(ModifierStack::Dirty dirty) {
+    editMesh->markDirty();
+    modifiers.invalidateBase(dirty);
+    modifiersDirty = true;
+}
 
-    for (auto &e : surface->edges) {
-        if (!edges.count(e->twin)) {
-            wprintf(L"Edge has invalid twin reference!\n");
-            valid = false;
-        } else {
-            if (e->twin == e.get()) {
-                wprintf(L"Edge's twin is itself!\n");
-                valid = false;
-            } else if (e->twin->twin != e.get()) {
-                wprintf(L"Edges are not twins!\n");
-                valid = false;
-            }
-        }
-        if (!edges.count(e->next)) {
-            wprintf(L"Edge has invalid next reference!\n");
-            valid = false;
-        } else {
-            if (e->next == e.get()) {
-                wprintf(L"Edge's next link is itself!\n");
-                valid = false;
-            } else if (e->next->prev != e.get()) {
-                wprintf(L"Edges are not linked!\n");
-                valid = false;
-            }
-        }
-        if (!edges.count(e->prev)) {
-            wprintf(L"Edge has invalid prev reference!\n");
-            valid = false;
-        } else {
-            if (e->prev == e.get()) {
-                wprintf(L"Edge's prev link is itself!\n");
-                valid = false;
-            }
+glm::vec3 snapPoint(glm::vec3 point) {
+    const float SNAP_DISTANCE = 0.25f;
+    if (dragMoving.empty()) {
+        // once per drag, everything that moves with the selection, including mirrors
+        dragMoving = selectedVertices;
+        if (proportional) {
+            for (auto &weight : softSelection.weights())
+                dragMoving.insert(weight.vertex);
         }
-        if (!faces.count(e->face)) {
-            wprintf(L"Edge has invalid face reference!\n");
-            valid = false;
-        } else {
-            bool foundEdge = false;
-            for (ITER_FACE_EDGES(e->face, faceEdge)) {
-                if (faceEdge == e.get()) {
-                    foundEdge = true;
-                    break;
-                }
-            }
-            if (!foundEdge) {
-                wprintf(L"Edge cannot be reached from face!\n");
-                valid = false;
-            }
-        }
-        if (!vertices.count(e->vert)) {
-            wprintf(L"Edge has invalid vertex reference!\n");
-            valid = false;
-        } else {
-            bool foundEdge = false;
-            for (ITER_VERTEX_EDGES(e->vert, vertEdge)) {
-                if (vertEdge == e.get()) {
-                    foundEdge = true;
-                    break;
-                }
-            }
-            if (!foundEdge) {
-                wprintf(L"Edge cannot be reached from vertex!\n");
-                valid = false;
-            }
-            if (e->vert == e->twin->vert) {
-                wprintf(L"Edge between single vertex!\n");
-                valid = false;
+        if (symmetric) {
+            std::vector<Vertex *> mirrors;
+            for (Vertex *vert : dragMoving) {
+                if (Vertex *mirror = symmetry.mirror(vert))
+                    mirrors.push_back(mirror);
             }
+            dragMoving.insert(mirrors.begin(), mirrors.end());
         }
     }
-
-    if (!valid)
-        wprintf(L"== Surface is not valid ==\n");
-    return valid;
+    snapIndex.prepare(&theSurface); // only rebuilds after topology changes
+    if (Vertex *vertex = snapIndex.nearestVertex(point, SNAP_DISTANCE, dragMoving))
+        return vertex->pos;
+    glm::vec3 surfacePoint;
+    if (snapIndex.nearestPointOnSurface(point, SNAP_DISTANCE, dragMoving, &surfacePoint))
+        return surfacePoint;
+    return point;
 }
 
-bool splitEdge(Surface *surface, HEdge *edge) {
-    HEdge *newEdge = surface->newEdge();
-    HEdge *newTwin = surface->newEdge();
-    linkTwins(newEdge, newTwin);
-
-    // insert newEdge between edge and edge->next
-    HEdge *next = edge->next, *twinPrev = edge->twin->prev;
-    linkNext(newEdge, next);
-    linkNext(twinPrev, newTwin);
-    linkNext(edge, newEdge);
-    linkNext(newTwin, edge->twin);
-
-    Vertex *newVert = surface->newVertex();
-    newVert->pos = (edge->vert->pos + edge->twin->vert->pos) / 2.0f;
-    newVert->edge = newEdge;
-
-    newEdge->vert = newVert;
-    newTwin->vert = edge->twin->vert;
-    newTwin->vert->edge = newTwin; // in case it was edge->twin
-    edge->twin->vert = newVert;
-
-    newEdge->face = edge->face;
-    newTwin->face = edge->twin->face;
-    return true;
-}
-
-bool splitFace(Surface *surface, HEdge *e1, HEdge *e2) {
-    if (e1->face != e2->face) {
-        wprintf(L"Edges must share a common face!\n");
-        return false;
-    } else if (e1->next == e2 || e2->next == e1) {
-        wprintf(L"Edge already exists between these vertices!\n");
-        return false;
-    }
-
-    HEdge *newEdge1 = surface->newEdge();
-    HEdge *newEdge2 = surface->newEdge();
-    linkTwins(newEdge1, newEdge2);
-
-    newEdge1->vert = e1->vert;
-    newEdge2->vert = e2->vert;
-
-    HEdge *e1Prev = e1->prev, *e2Prev = e2->prev;
-    linkNext(newEdge1, e2);
-    linkNext(newEdge2, e1);
-    linkNext(e1Prev, newEdge1);
-    linkNext(e2Prev, newEdge2);
-
-    newEdge1->face = e1->face;
-    newEdge1->face->edge = newEdge1;
-    Face *newFace = surface->newFace();
-    newFace->edge = newEdge2;
-    for (ITER_FACE_EDGES(newFace, newFaceEdge))
-        newFaceEdge->face = newFace;
-    return true;
-}
-
-bool addFaceVertex(Surface *surface, HEdge *edge) {
-    HEdge *newEdge = surface->newEdge();
-    HEdge *newTwin = surface->newEdge();
-    linkTwins(newEdge, newTwin);
-
-    linkNext(newTwin, newEdge);
-    linkNext(edge->prev, newTwin);
-    linkNext(newEdge, edge);
-
-    Vertex *newVert = surface->newVertex();
-    newVert->pos = edge->vert->pos;
-    newVert->edge = newEdge;
-
-    newEdge->vert = newVert;
-    newTwin->vert = edge->vert;
-    newTwin->vert->edge = newTwin; // in case it was edge
-
-    newEdge->face = edge->face;
-    newTwin->face = edge->face;
-    return true;
-}
-
-bool removeTwoSidedFace(Surface *surface, Face *face) {
-    if (face->edge->next->next != face->edge)
-        return false; // face has more than two sides
-    wprintf(L"Deleting face\n");
-    HEdge *edge1 = face->edge, *edge2 = face->edge->next;
-    edge1->vert->edge = edge1->twin->next;
-    edge2->vert->edge = edge2->twin->next;
-    edge1->twin->twin = edge2->twin;
-    edge2->twin->twin = edge1->twin;
-    surface->deleteEdge(edge1);
-    surface->deleteEdge(edge2);
-    surface->deleteFace(face);
-    return true;
+void faceVertex(Vertex *vertex) {
+    glTexCoord2f(vertex->pos.x, vertex->pos.y);
+    glVertex3fv(glm::value_ptr(vertex->pos));
 }
 
-bool mergeVerticesAlongEdge(Surface *surface, HEdge *edge) {
-    // similar structure to deleteEdge
-    HEdge *twin = edge->twin;
-    Vertex *keepVert = edge->vert, *oldVert = twin->vert;
-    for (ITER_VERTEX_EDGES(oldVert, vertEdge))
-        vertEdge->vert = keepVert;
-    surface->deleteVertex(oldVert);
-
-    if (edge->next == twin) {
-        edge->face->edge = edge->prev;
-        edge->vert->edge = edge->prev;
-    } else {
-        edge->face->edge = edge->next;
-        edge->vert->edge = edge->next;
+// editing shows the selection
+void drawSurface(Surface *surface, bool editing) {
+    glColor3f(1, 1, 1);
+    glBegin(GL_LINES);
+    for (auto &edge : surface->edges) {
+        if (edge.get() != selectedEdge && edge->twin != selectedEdge 
+                && edge->primary() == edge.get()) {
+            glm::vec3 v1 = edge->vert->pos, v2 = edge->twin->vert->pos;
+            glVertex3fv(glm::value_ptr(v1));
+            glVertex3fv(glm::value_ptr(v2));
+        }
     }
-    if (twin->next == edge) {
-        twin->face->edge = twin->prev;
-    } else {
-        twin->face->edge = twin->next;
+    glEnd();
+
+    if (editing) {
+        glLineWidth(5);
+        glBegin(GL_LINE_STRIP);
+        glm::vec3 v1 = selectedEdge->vert->pos, v2 = selectedEdge->twin->vert->pos;
+        glColor3f(0.3f, 1, 0.3f);
+        glVertex3fv(glm::value_ptr(v2));
+        glColor3f(1, 0.3f, 0.3f);
+        glVertex3fv(glm::value_ptr(v1));
+        glm::vec3 normPoint = v1 + selectedEdge->face->normal() * 0.4f;
+        glVertex3fv(glm::value_ptr(normPoint));
+        glEnd();
+        glLineWidth(1);
     }
 
-    // this works even if prev or next == twin
-    linkNext(edge->prev, edge->next);
-    linkNext(twin->prev, twin->next);
-    // TODO detect if entire solid should be deleted
-    removeTwoSidedFace(surface, edge->face);
-    removeTwoSidedFace(surface, twin->face);
-    surface->deleteEdge(edge);
-    surface->deleteEdge(twin);
-    return true;
-}
-
-// TODO: mergeVerticesOnFace() -- equivalent to splitFace + mergeVerticesAlongEdge
-
-bool deleteEdge(Surface *surface, HEdge *edge) {
-    HEdge *twin = edge->twin;
-    if (edge->face != twin->face) {
-        Face *keepFace = edge->face, *oldFace = twin->face;
-        for (ITER_FACE_EDGES(oldFace, faceEdge))
-            faceEdge->face = keepFace;
-        surface->deleteFace(oldFace);
-    } else if (edge->next != twin && edge->prev != twin) {
-        wprintf(L"Deleting this edge would create a hole in the face!\n");
-        return false;
-    }
-
-    if (edge->next == twin) {
-        surface->deleteVertex(twin->vert);
-        edge->face->edge = edge->prev;
-    } else {
-        twin->vert->edge = edge->next;
-        edge->face->edge = edge->next;
+    glColor3f(0, 1, 0);
+    glPointSize(9);
+    glBegin(GL_POINTS);
+    for (auto &vertex : surface->vertices) {
+        glm::vec3 v = vertex->pos;
+        bool selected = selectedVertices.count(vertex.get());
+        if (selected)
+            glColor3f(1, 0, 0);
+        glVertex3fv(glm::value_ptr(v));
+        if (selected)
+            glColor3f(0, 1, 0);
     }
-    if (twin->next == edge) {
-        surface->deleteVertex(edge->vert);
-    } else {
-        edge->vert->edge = twin->next;
+    glEnd();
+
+    glColor3f(0, 0, 1);
+    glEnable(GL_TEXTURE_2D);
+    // glPolygonMode(GL_FRONT, GL_LINE);
+    // TODO cache faces!
+    static std::vector<Vertex *> faceVerts;
+    static std::vector<glm::dvec2> facePoints;
+    static std::vector<int> faceTriangles;
+    glBegin(GL_TRIANGLES);
+    for (auto &face : surface->faces) {
+        if (face.get() == selectedEdge->face)
+            glColor3f(0, 0.5, 1);
+        faceVerts.clear();
+        for (ITER_FACE_EDGES(face, edge))
+            faceVerts.push_back(edge->vert);
+        if (faceVerts.size() == 3) {
+            for (Vertex *vert : faceVerts)
+                faceVertex(vert);
+        } else {
+            projectFace(face.get(), &facePoints);
+            faceTriangles.clear();
+            triangulatePolygon(facePoints, &faceTriangles);
+            for (int i : faceTriangles)
+                faceVertex(faceVerts[i]);
+        }
+        if (face.get() == selectedEdge->face)
+            glColor3f(0, 0, 1);
     }
-
-    linkNext(edge->prev, twin->next);
-    linkNext(twin->prev, edge->next);
-    surface->deleteEdge(edge);
-    surface->deleteEdge(twin);
-    // TODO detect if entire solid should be deleted
-    return true;
+    glEnd();
+    glDisable(GL_TEXTURE_2D);
 }
 
-bool extrudeFace(Surface *surface, Face *face) {
-    // face will become the top face
-    HEdge *topFirst = nullptr, *topPrev = nullptr;
-    for (ITER_FACE_EDGES(face, baseEdge)) {
-        HEdge *topEdge = surface->newEdge();
-        HEdge *topTwin = surface->newEdge();
-        linkTwins(topEdge, topTwin);
-        HEdge *joinEdge = surface->newEdge();
-        HEdge *joinTwin = surface->newEdge();
-        linkTwins(joinEdge, joinTwin);
-
-        // incomplete side face loop
-        linkNext(topTwin, joinEdge);
-        linkNext(joinEdge, baseEdge);
-        // top face loop
-        if (topPrev)
-            linkNext(topPrev, topEdge);
-        else
-            topFirst = topEdge;
-        topPrev = topEdge;
-
-        Vertex *topVert = surface->newVertex();
-        topVert->pos = baseEdge->vert->pos;
-        topVert->edge = joinEdge;
-        joinEdge->vert = topVert;
-        topEdge->vert = topVert;
-        joinTwin->vert = baseEdge->vert;
-
-        Face *sideFace = surface->newFace();
-        sideFace->edge = joinEdge;
-        joinEdge->face = sideFace;
-        topTwin->face = sideFace;
-        baseEdge->face = sideFace;
-
-        topEdge->face = face;
-    }
-    linkNext(topPrev, topFirst);
-    face->edge = topFirst;
-
-    for (ITER_FACE_EDGES(face, topEdge)) {
-        // complete side face loop
-        linkNext(topEdge->next->twin->next->twin, topEdge->twin);
-        linkNext(topEdge->twin->next->next, topEdge->twin->prev);
-
-        topEdge->twin->prev->face = topEdge->twin->face;
-        topEdge->twin->vert = topEdge->next->vert;
+// modifier output, drawn over the edited surface
+void drawWireframe(const Surface *surface) {
+    glColor3f(0.6f, 0.6f, 0.6f);
+    glBegin(GL_LINES);
+    for (auto &edge : surface->edges) {
+        if (edge->id < edge->twin->id) {
+            glVertex3fv(glm::value_ptr(edge->vert->pos));
+            glVertex3fv(glm::value_ptr(edge->twin->vert->pos));
+        }
     }
-    return true;
-}
-
-void tessVertexCallback(Vertex *vertex) {
-    glTexCoord2f(vertex->pos.x, vertex->pos.y);
-    glVertex3fv(glm::value_ptr(vertex->pos));
-}
-
-void tessErrorCallback(GLenum errorCode) {
-    wprintf(L"Tessellation error: %S\n", gluErrorString(errorCode));
+    glEnd();
 }
 
 LRESULT CALLBACK mainWindowProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam) {
@@ -495,36 +219,40 @@ LRESULT CALLBACK mainWindowProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM l
             glEnable(GL_POLYGON_OFFSET_FILL);
             glPolygonOffset(1.0, 1.0);
 
-            tess = gluNewTess();
-            gluTessCallback(tess, GLU_TESS_BEGIN, (GLvoid (*) ())glBegin);
-            gluTessCallback(tess, GLU_TESS_END, (GLvoid (*) ())glEnd);
-            gluTessCallback(tess, GLU_TESS_VERTEX, (GLvoid (*) ())tessVertexCallback);
-            gluTessCallback(tess, GLU_TESS_ERROR, (GLvoid (*) ())tessErrorCallback);
-            // gluTessCallback(tess, GLU_TESS_COMBINE, (GLvoid (*) ())tessCombineCallback);
-            // gluTessCallback(tess, GLU_TESS_EDGE_FLAG, (GLvoid (*) ())glEdgeFlag);
-
-            HBITMAP textureHBitmap = LoadBitmap(GetModuleHandle(nullptr),
-                MAKEINTRESOURCE(IDR_DEFAULT_TEXTURE));
-            if (!textureHBitmap)
-                wprintf(L"Error loading bitmap %d\n", GetLastError());
-            BITMAP textureBitmap;
-            GetObject(textureHBitmap, sizeof(textureBitmap), &textureBitmap);
+            std::shared_ptr<const Texture> texture;
+            if (texturePath) {
+                texture = textureCache.load(texturePath);
+            } else {
+                HRSRC resource = FindResource(nullptr, MAKEINTRESOURCE(IDR_DEFAULT_TEXTURE),
+                    RT_RCDATA);
+                HGLOBAL resourceData = resource ? LoadResource(nullptr, resource) : nullptr;
+                if (resourceData) {
+                    texture = textureCache.load("default",
+                        (const uint8_t *)LockResource(resourceData),
+                        SizeofResource(nullptr, resource));
+                }
+            }
+            if (!texture)
+                wprintf(L"Error loading texture!\n");
             GLuint textureName;
             glGenTextures(1, &textureName);
             glBindTexture(GL_TEXTURE_2D, textureName);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, textureBitmap.bmWidth, textureBitmap.bmHeight,
-                0, GL_RGB, GL_UNSIGNED_BYTE, textureBitmap.bmBits);
-            // gluBuild2DMipmaps(GL_TEXTURE_2D, GL_RGBA, textureBitmap.bmWidth, textureBitmap.bmHeight,
-            //     GL_R, GL_UNSIGNED_BYTE, textureBitmap.bmBits);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            if (texture) {
+                // every level down to 1x1, otherwise the texture is incomplete
+                for (size_t level = 0; level < texture->levels.size(); level++) {
+                    const Image &image = texture->levels[level];
+                    glTexImage2D(GL_TEXTURE_2D, (GLint)level, GL_RGBA, image.width, image.height,
+                        0, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels.data());
+                }
+            }
 
             return 0;
         }
         case WM_DESTROY: {
-            gluDeleteTess(tess);
             HGLRC context = wglGetCurrentContext();
             if (context) {
                 HDC dc = wglGetCurrentDC();
@@ -554,15 +282,34 @@ LRESULT CALLBACK mainWindowProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM l
                 lastMouseX = GET_X_LPARAM(lParam);
                 lastMouseY = GET_Y_LPARAM(lParam);
                 SetCapture(hwnd);
+                if (proportional)
+                    softSelection.begin(selectedVertices, softSelection.radius());
+                dragAnchor = nullptr;
+                if (selectedVertices.count(selectedEdge->vert))
+                    dragAnchor = selectedEdge->vert;
+                else if (!selectedVertices.empty())
+                    dragAnchor = *selectedVertices.begin();
+                if (dragAnchor)
+                    dragTarget = dragAnchor->pos;
             } else {
                 if (!(GetKeyState(VK_SHIFT) < 0))
                     selectedVertices.clear();
                 glm::vec2 cursor = {GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam)};
-                auto result = picker.pickSurfaceElement(&theSurface, Surface::VERTEX,
-                    cursor, windowDim, projMat * mvMat);
-                if (result.type == Surface::VERTEX) {
-                    selectedVertices.insert(result.vertex);
-                    selectedEdge = result.vertex->edge;
+                glm::vec2 ndcCursor = cursor / windowDim * 2.0f - 1.0f;
+                ndcCursor.y *= -1;
+                scene.update();
+                std::vector<SceneObject *> candidates;
+                scene.pickCandidates(projMat * mvMat, ndcCursor, 9.0f / windowDim, &candidates);
+                for (SceneObject *object : candidates) {
+                    if (object->mesh != editMesh)
+                        continue;
+                    auto result = picker.pickSurfaceElement(&theSurface, Surface::VERTEX,
+                        cursor, windowDim, projMat * mvMat * object->transform);
+                    if (result.type == Surface::VERTEX) {
+                        selectedVertices.insert(result.vertex);
+                        selectedEdge = result.vertex->edge;
+                        break;
+                    }
                 }
                 InvalidateRect(hwnd, nullptr, FALSE);
             }
@@ -570,6 +317,9 @@ LRESULT CALLBACK mainWindowProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM l
         }
         case WM_LBUTTONUP:
             ReleaseCapture();
+            softSelection.clear();
+            dragMoving.clear();
+            dragAnchor = nullptr;
             return 0;
         case WM_RBUTTONDOWN:
             lastMouseX = GET_X_LPARAM(lParam);
@@ -593,14 +343,41 @@ LRESULT CALLBACK mainWindowProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM l
                     delta = {mouseX - lastMouseX, 0, mouseY - lastMouseY};
                     delta = glm::rotateY(delta, -rotY);
                 }
-                for (auto &vert : selectedVertices)
-                    vert->pos += delta / 150.0f;
+                glm::vec3 offset = delta / 150.0f;
+                if (dragAnchor) {
+                    dragTarget += offset;
+                    glm::vec3 snapped = dragTarget;
+                    if (GetKeyState(VK_CONTROL) < 0)
+                        snapped = snapPoint(dragTarget);
+                    offset = snapped - dragAnchor->pos;
+                }
+                std::vector<std::pair<Vertex *, glm::vec3>> moves;
+                if (proportional) {
+                    for (auto &weight : softSelection.weights())
+                        moves.push_back({weight.vertex, offset * weight.weight});
+                } else {
+                    for (auto &vert : selectedVertices)
+                        moves.push_back({vert, offset});
+                }
+                opLog.moveVertices(moves, symmetric ? &symmetry : nullptr);
+                std::vector<Vertex *> moved;
+                for (auto &move : moves) {
+                    moved.push_back(move.first);
+                    if (Vertex *mirror = symmetric ? symmetry.mirror(move.first) : nullptr)
+                        moved.push_back(mirror);
+                }
+                snapIndex.update(moved);
+                surfaceChanged(ModifierStack::POSITIONS);
                 InvalidateRect(hwnd, nullptr, FALSE);
             }
             lastMouseX = mouseX;
             lastMouseY = mouseY;
             return 0;
         }
+        case WM_TIMER:
+            if (wParam == MODIFIER_TIMER)
+                InvalidateRect(hwnd, nullptr, FALSE);
+            return 0;
         case WM_KEYDOWN:
             switch (wParam) {
                 // selection
@@ -636,6 +413,100 @@ LRESULT CALLBACK mainWindowProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM l
                         selectedVertices.insert(faceEdge->vert);
                     InvalidateRect(hwnd, nullptr, FALSE);
                     return 0;
+                case 'L':
+                case 'R': {
+                    std::vector<HEdge *> edges;
+                    bool closed = wParam == 'L' ? edgeLoop(selectedEdge, &edges)
+                        : edgeRing(selectedEdge, &edges);
+                    if (GetKeyState(VK_SHIFT) >= 0)
+                        selectedVertices.clear();
+                    selectEdgeVertices(edges, &selectedVertices);
+                    wprintf(L"Selected %s of %d edges%s\n", wParam == 'L' ? L"loop" : L"ring",
+                        (int)edges.size(), closed ? L"" : L" (open)");
+                    InvalidateRect(hwnd, nullptr, FALSE);
+                    return 0;
+                }
+                case 'G': {
+                    if (selectedVertices.size() != 2) {
+                        wprintf(L"Select two vertices!\n");
+                        return 0;
+                    }
+                    Vertex *a = *selectedVertices.begin(), *b = *std::next(selectedVertices.begin());
+                    std::vector<HEdge *> edges;
+                    if (shortestPath(&theSurface, a, b, &edges)) {
+                        selectEdgeVertices(edges, &selectedVertices);
+                        wprintf(L"Selected path of %d edges\n", (int)edges.size());
+                    }
+                    InvalidateRect(hwnd, nullptr, FALSE);
+                    return 0;
+                }
+                case 'B':
+                    proportional = !proportional;
+                    wprintf(L"Proportional editing %s\n", proportional ? L"on" : L"off");
+                    return 0;
+                case VK_OEM_4: // [
+                    softSelection.setRadius(softSelection.radius() / 1.25f);
+                    wprintf(L"Falloff radius %f\n", softSelection.radius());
+                    return 0;
+                case VK_OEM_6: // ]
+                    softSelection.setRadius(softSelection.radius() * 1.25f);
+                    wprintf(L"Falloff radius %f\n", softSelection.radius());
+                    return 0;
+                case 'X':
+                    if (symmetric) {
+                        breakSymmetry();
+                    } else if (opLog.buildSymmetry(&symmetry, &theSurface)) {
+                        symmetric = true;
+                        wprintf(L"Symmetry on\n");
+                    }
+                    return 0;
+                case 'C': {
+                    // instance of the edited mesh, in a row with the others
+                    glm::vec3 offset(3.0f * scene.objects.size(), 0, 0);
+                    scene.add(editMesh, glm::translate(glm::mat4(1), offset));
+                    wprintf(L"Added instance\n");
+                    InvalidateRect(hwnd, nullptr, FALSE);
+                    return 0;
+                }
+                // modifiers
+                case '1':
+                    modifiers.add(std::make_unique<MirrorModifier>());
+                    wprintf(L"Added mirror modifier\n");
+                    modifiersDirty = true;
+                    InvalidateRect(hwnd, nullptr, FALSE);
+                    return 0;
+                case '2':
+                    modifiers.add(std::make_unique<ArrayModifier>());
+                    wprintf(L"Added array modifier\n");
+                    modifiersDirty = true;
+                    InvalidateRect(hwnd, nullptr, FALSE);
+                    return 0;
+                case '3':
+                    modifiers.add(std::make_unique<SubdivideModifier>());
+                    wprintf(L"Added subdivide modifier\n");
+                    modifiersDirty = true;
+                    InvalidateRect(hwnd, nullptr, FALSE);
+                    return 0;
+                case '4':
+                    modifiers.add(std::make_unique<SolidifyModifier>());
+                    wprintf(L"Added solidify modifier\n");
+                    modifiersDirty = true;
+                    InvalidateRect(hwnd, nullptr, FALSE);
+                    return 0;
+                case '0':
+                    modifiers.clear();
+                    wprintf(L"Removed modifiers\n");
+                    InvalidateRect(hwnd, nullptr, FALSE);
+                    return 0;
+                case 'M': {
+                    MemoryUsage usage;
+                    addSurfaceMemory(theSurface, &usage);
+                    addContainerMemory(L"selection", selectedVertices, &usage);
+                    softSelection.addMemoryUsage(&usage);
+                    textureCache.addMemoryUsage(&usage);
+                    usage.print();
+                    return 0;
+                }
                 case VK_RETURN:
                     wprintf(L"Store edge\n");
                     storedEdge = selectedEdge;
@@ -644,47 +515,81 @@ LRESULT CALLBACK mainWindowProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM l
                 case 'D':
                     if (GetKeyState(VK_SHIFT) < 0) {
                         Vertex *selectedVertex = selectedEdge->vert;
-                        if (mergeVerticesAlongEdge(&theSurface, selectedEdge))
+                        if (opLog.mergeVerticesAlongEdge(&theSurface, selectedEdge))
                             selectedEdge = selectedVertex->edge;
+                        breakSymmetry();
                     } else {
-                        splitEdge(&theSurface, selectedEdge);
+                        opLog.splitEdge(&theSurface, selectedEdge, symmetric ? &symmetry : nullptr);
                     }
+                    surfaceChanged(ModifierStack::TOPOLOGY);
                     validateSurface(&theSurface);
                     InvalidateRect(hwnd, nullptr, FALSE);
                     return 0;
                 case 'E':
                     if (GetKeyState(VK_SHIFT) < 0) {
                         Face *selectedFace = selectedEdge->face;
-                        if (deleteEdge(&theSurface, selectedEdge))
+                        if (opLog.deleteEdge(&theSurface, selectedEdge))
                             selectedEdge = selectedFace->edge;
+                        breakSymmetry();
                     } else {
                         if (!storedEdge) {
                             wprintf(L"Must have an edge stored!\n");
                         } else {
-                            splitFace(&theSurface, storedEdge, selectedEdge);
+                            opLog.splitFace(&theSurface, storedEdge, selectedEdge,
+                                symmetric ? &symmetry : nullptr);
                         }
                     }
+                    surfaceChanged(ModifierStack::TOPOLOGY);
                     validateSurface(&theSurface);
                     InvalidateRect(hwnd, nullptr, FALSE);
                     return 0;
                 case 'V':
-                    if (addFaceVertex(&theSurface, selectedEdge)) {
+                    if (opLog.addFaceVertex(&theSurface, selectedEdge)) {
                         selectedEdge = selectedEdge->prev;
                         selectedVertices.clear();
                         selectedVertices.insert(selectedEdge->vert);
                         wprintf(L"Added vertex\n");
+                        breakSymmetry();
                     }
+                    surfaceChanged(ModifierStack::TOPOLOGY);
                     validateSurface(&theSurface);
                     InvalidateRect(hwnd, nullptr, FALSE);
                     return 0;
+                case 'W': {
+                    int welded = opLog.weldVertices(&theSurface, 0.001f);
+                    wprintf(L"Welded %d vertices\n", welded);
+                    if (welded) {
+                        breakSymmetry();
+                        // selection may have been deleted
+                        selectedEdge = theSurface.edges[0].get();
+                        storedEdge = nullptr;
+                        selectedVertices.clear();
+                    }
+                    surfaceChanged(ModifierStack::TOPOLOGY);
+                    validateSurface(&theSurface);
+                    InvalidateRect(hwnd, nullptr, FALSE);
+                    return 0;
+                }
+                case 'S': {
+                    SmoothOptions options;
+                    options.taubin = GetKeyState(VK_SHIFT) < 0;
+                    opLog.smoothSurface(&theSurface, options, selectedVertices);
+                    snapIndex.clear(); // moved without changing topology
+                    surfaceChanged(ModifierStack::POSITIONS);
+                    wprintf(L"Smoothed\n");
+                    InvalidateRect(hwnd, nullptr, FALSE);
+                    return 0;
+                }
                 case 'P': {
                     Face *extrudedFace = selectedEdge->face;
-                    if (extrudeFace(&theSurface, extrudedFace)) {
+                    if (opLog.extrudeFace(&theSurface, extrudedFace,
+                            symmetric ? &symmetry : nullptr)) {
                         selectedVertices.clear();
                         for (ITER_FACE_EDGES(extrudedFace, faceEdge))
                             selectedVertices.insert(faceEdge->vert);
                         wprintf(L"Extruded face\n");
                     }
+                    surfaceChanged(ModifierStack::TOPOLOGY);
                     validateSurface(&theSurface);
                     InvalidateRect(hwnd, nullptr, FALSE);
                     return 0;
@@ -705,68 +610,30 @@ LRESULT CALLBACK mainWindowProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM l
             mvMat = glm::rotate(mvMat, rotY, glm::vec3(0, 1, 0));
             glLoadMatrixf(glm::value_ptr(mvMat));
 
-            glColor3f(1, 1, 1);
-            glBegin(GL_LINES);
-            for (auto &edge : theSurface.edges) {
-                if (edge.get() != selectedEdge && edge->twin != selectedEdge 
-                        && edge->primary() == edge.get()) {
-                    glm::vec3 v1 = edge->vert->pos, v2 = edge->twin->vert->pos;
-                    glVertex3fv(glm::value_ptr(v1));
-                    glVertex3fv(glm::value_ptr(v2));
-                }
+            // start evaluating the latest changes, unless the last evaluation is still running.
+            // until then the previous result is shown
+            const Surface *modified = nullptr;
+            if (modifiers.size()) {
+                if (modifiersDirty && modifiers.evaluateAsync(theSurface))
+                    modifiersDirty = false;
+                modified = modifiers.result();
             }
-            glEnd();
-
-            glLineWidth(5);
-            glBegin(GL_LINE_STRIP);
-            {
-                glm::vec3 v1 = selectedEdge->vert->pos, v2 = selectedEdge->twin->vert->pos;
-                glColor3f(0.3f, 1, 0.3f);
-                glVertex3fv(glm::value_ptr(v2));
-                glColor3f(1, 0.3f, 0.3f);
-                glVertex3fv(glm::value_ptr(v1));
-                glm::vec3 normPoint = v1 + selectedEdge->face->normal() * 0.4f;
-                glVertex3fv(glm::value_ptr(normPoint));
+            if (modifiersDirty || modifiers.evaluating())
+                SetTimer(hwnd, MODIFIER_TIMER, 15, nullptr); // repaint when it's done
+            else
+                KillTimer(hwnd, MODIFIER_TIMER);
+
+            scene.update();
+            std::vector<SceneObject *> visible;
+            scene.cull(projMat * mvMat, &visible);
+            for (SceneObject *object : visible) {
+                glPushMatrix();
+                glMultMatrixf(glm::value_ptr(object->transform));
+                drawSurface(&object->mesh->surface, object->mesh == editMesh);
+                if (modified && object->mesh == editMesh)
+                    drawWireframe(modified);
+                glPopMatrix();
             }
-            glEnd();
-            glLineWidth(1);
-
-            glColor3f(0, 1, 0);
-            glPointSize(9);
-            glBegin(GL_POINTS);
-            for (auto &vertex : theSurface.vertices) {
-                glm::vec3 v = vertex->pos;
-                bool selected = selectedVertices.count(vertex.get());
-                if (selected)
-                    glColor3f(1, 0, 0);
-                glVertex3fv(glm::value_ptr(v));
-                if (selected)
-                    glColor3f(0, 1, 0);
-            }
-            glEnd();
-
-            glColor3f(0, 0, 1);
-            glEnable(GL_TEXTURE_2D);
-            // glPolygonMode(GL_FRONT, GL_LINE);
-            // TODO cache faces!
-            for (auto &face : theSurface.faces) {
-                if (face.get() == selectedEdge->face)
-                    glColor3f(0, 0.5, 1);
-                // https://www.glprogramming.com/red/chapter11.html
-                glm::vec3 normal = face->normal();
-                gluTessNormal(tess, normal.x, normal.y, normal.z);
-                gluTessBeginPolygon(tess, nullptr);
-                gluTessBeginContour(tess);
-                for (ITER_FACE_EDGES(face, edge)) {
-                    glm::dvec3 dPos = edge->vert->pos;
-                    gluTessVertex(tess, glm::value_ptr(dPos), edge->vert);
-                }
-                gluTessEndContour(tess);
-                gluTessEndPolygon(tess);
-                if (face.get() == selectedEdge->face)
-                    glColor3f(0, 0, 1);
-            }
-            glDisable(GL_TEXTURE_2D);
 
 
             HDC dc = GetDC(hwnd);
@@ -780,8 +647,17 @@ LRESULT CALLBACK mainWindowProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM l
     return DefWindowProc(hwnd, message, wParam, lParam);
 }
 
-int main(int, char **) {
-    makeCube(&theSurface);
+int main(int argc, char **argv) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        // replay with: batch replay file
+        if (strcmp(argv[i], "--record") == 0 && opLog.record(argv[i + 1]))
+            wprintf(L"Recording to %hs\n", argv[i + 1]);
+        else if (strcmp(argv[i], "--texture") == 0) // BMP, PNG or TGA
+            texturePath = argv[i + 1];
+    }
+    opLog.makeCube(&theSurface);
+    scene.add(editMesh);
+    selectedEdge = theSurface.edges[0].get();
     validateSurface(&theSurface);
 
     // register window class
@@ -0,0 +1,148 @@
+#include "memusage.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cwchar>
+#include <new>
+
+namespace winged {
+
+namespace {
+
+struct ThreadCounts {
+    size_t count, bytes;
+    int counters; // AllocationCounters alive on this thread
+};
+// trivial, so it's safe to use from operator new at any point in the thread's life
+thread_local ThreadCounts threadCounts;
+
+template<typename T>
+void addElements(const wchar_t *name, const std::vector<std::unique_ptr<T>> &vec,
+        MemoryUsage *usage) {
+    size_t n = vec.size(), pointers = vec.capacity() * sizeof(vec[0]);
+    size_t objectOverhead = heapBlockSize(sizeof(T)) - sizeof(T);
+    size_t vectorOverhead = vec.capacity() ? heapBlockSize(pointers) - pointers : 0;
+    usage->categories.push_back({name, n, n * (sizeof(T) + sizeof(vec[0])),
+        (vec.capacity() - n) * sizeof(vec[0]), n * objectOverhead + vectorOverhead});
+}
+
+} // namespace
+
+size_t MemoryUsage::total() const {
+    size_t sum = 0;
+    for (auto &category : categories)
+        sum += category.total();
+    return sum;
+}
+
+void MemoryUsage::print() const {
+    wprintf(L"%-16ls %10ls %12ls %12ls %12ls\n", L"", L"count", L"bytes", L"slack",
+        L"overhead");
+    size_t bytes = 0, slack = 0, overhead = 0;
+    for (auto &category : categories) {
+        wprintf(L"%-16ls %10zu %12zu %12zu %12zu\n", category.name, category.count,
+            category.bytes, category.slack, category.overhead);
+        bytes += category.bytes;
+        slack += category.slack;
+        overhead += category.overhead;
+    }
+    wprintf(L"%-16ls %10ls %12zu %12zu %12zu = %.2f MB\n", L"total", L"", bytes, slack,
+        overhead, total() / (1024.0 * 1024.0));
+}
+
+size_t heapBlockSize(size_t size) {
+    return std::max((size + 8 + 15) & ~(size_t)15, (size_t)32);
+}
+
+void addSurfaceMemory(const Surface &surface, MemoryUsage *usage) {
+    addElements(L"vertices", surface.vertices, usage);
+    addElements(L"faces", surface.faces, usage);
+    addElements(L"edges", surface.edges, usage);
+}
+
+AllocationCounter::AllocationCounter()
+    : startCount(threadCounts.count), startBytes(threadCounts.bytes) {
+    threadCounts.counters++;
+}
+
+AllocationCounter::~AllocationCounter() {
+    threadCounts.counters--;
+}
+
+size_t AllocationCounter::count() const {
+    return threadCounts.count - startCount;
+}
+
+size_t AllocationCounter::bytes() const {
+    return threadCounts.bytes - startBytes;
+}
+
+} // namespace
+
+// replaces the global allocator for the whole program. every non-aligned form is replaced so
+// that none of them can be paired with a library version of another
+
+static void * allocate(std::size_t size) {
+    winged::ThreadCounts &counts = winged::threadCounts;
+    if (counts.counters) {
+        counts.count++;
+        counts.bytes += size;
+    }
+    if (size == 0)
+        size = 1;
+    while (true) {
+        if (void *ptr = std::malloc(size))
+            return ptr;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+
+static void * allocate(std::size_t size, const std::nothrow_t &) noexcept {
+    try {
+        return allocate(size);
+    } catch (const std::bad_alloc &) {
+        return nullptr;
+    }
+}
+
+void * operator new(std::size_t size) {
+    return allocate(size);
+}
+
+void * operator new[](std::size_t size) {
+    return allocate(size);
+}
+
+void * operator new(std::size_t size, const std::nothrow_t &tag) noexcept {
+    return allocate(size, tag);
+}
+
+void * operator new[](std::size_t size, const std::nothrow_t &tag) noexcept {
+    return allocate(size, tag);
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept {
+    std::free(ptr);
+}
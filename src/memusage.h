@@ -0,0 +1,83 @@
+#pragma once
+#include <common.h>
+
+#include "surface.h"
+#include <cstddef>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace winged {
+
+// estimated heap memory, broken down by what it's used for. allocator overhead can't be
+// measured portably, so it assumes 16 byte granularity with an 8 byte header, which is what
+// both glibc and the Windows heap do on 64-bit
+struct MemoryUsage {
+    struct Category {
+        const wchar_t *name;
+        size_t count; // elements
+        size_t bytes; // used by the elements themselves
+        size_t slack; // allocated but unused container capacity
+        size_t overhead; // allocator headers and rounding, container bookkeeping
+        size_t total() const { return bytes + slack + overhead; }
+    };
+    std::vector<Category> categories;
+
+    size_t total() const;
+    void print() const;
+};
+
+// size of the heap block for an allocation of size bytes, including the header
+size_t heapBlockSize(size_t size);
+
+// vertices, faces and edges, each counting the objects and their vector of pointers. O(1)
+void addSurfaceMemory(const Surface &surface, MemoryUsage *usage);
+
+template<typename T>
+void addContainerMemory(const wchar_t *name, const std::vector<T> &vec, MemoryUsage *usage) {
+    size_t block = vec.capacity() ? heapBlockSize(vec.capacity() * sizeof(T)) : 0;
+    usage->categories.push_back({name, vec.size(), vec.size() * sizeof(T),
+        (vec.capacity() - vec.size()) * sizeof(T), block - vec.capacity() * sizeof(T)});
+}
+
+// one heap node per element, plus the bucket array. the layout differs between standard
+// libraries, this assumes MSVC's: next and previous pointers in each node and two per bucket.
+// libstdc++ uses one of each, so it's an overestimate there
+template<typename Value, typename Set>
+void addHashMemory(const wchar_t *name, const Set &set, MemoryUsage *usage) {
+    size_t node = heapBlockSize(sizeof(Value) + 2 * sizeof(void *));
+    size_t buckets = set.bucket_count() * 2 * sizeof(void *);
+    usage->categories.push_back({name, set.size(), set.size() * sizeof(Value), 0,
+        set.size() * (node - sizeof(Value)) + heapBlockSize(buckets)});
+}
+
+template<typename T>
+void addContainerMemory(const wchar_t *name, const std::unordered_set<T> &set,
+        MemoryUsage *usage) {
+    addHashMemory<T>(name, set, usage);
+}
+
+template<typename K, typename V>
+void addContainerMemory(const wchar_t *name, const std::unordered_map<K, V> &map,
+        MemoryUsage *usage) {
+    addHashMemory<std::pair<const K, V>>(name, map, usage);
+}
+
+// counts heap allocations (operator new) by the current thread while it exists, to find
+// operations which allocate too much. counters can be nested. work handed to other threads,
+// eg. by parallelFor, isn't counted. costs nothing measurable when no counter exists
+class AllocationCounter {
+public:
+    AllocationCounter();
+    ~AllocationCounter();
+    AllocationCounter(const AllocationCounter &) = delete;
+    AllocationCounter & operator=(const AllocationCounter &) = delete;
+
+    size_t count() const; // allocations since construction
+    size_t bytes() const; // bytes requested since construction, not subtracting frees
+
+private:
+    size_t startCount, startBytes;
+};
+
+} // namespace
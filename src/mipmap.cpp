@@ -0,0 +1,122 @@
+#include "mipmap.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#if defined(__SSE2__) || defined(_M_X64)
+#define MIP_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace winged {
+
+// sRGB values to 16 bit linear, and back from the top 16 bits of the linear average
+struct GammaTables {
+    uint16_t toLinear[256];
+    uint8_t toSrgb[65536];
+
+    GammaTables() {
+        for (int i = 0; i < 256; i++) {
+            float c = i / 255.0f;
+            float linear = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            toLinear[i] = (uint16_t)std::lround(linear * 65535);
+        }
+        for (int i = 0; i < 65536; i++) {
+            float linear = i / 65535.0f;
+            float c = linear <= 0.0031308f ? linear * 12.92f
+                : 1.055f * std::pow(linear, 1 / 2.4f) - 0.055f;
+            toSrgb[i] = (uint8_t)std::lround(std::min(std::max(c, 0.0f), 1.0f) * 255);
+        }
+    }
+};
+
+static const GammaTables & gammaTables() {
+    static const GammaTables tables;
+    return tables;
+}
+
+static void boxRow(const uint8_t *row0, const uint8_t *row1, int srcWidth, int width,
+        uint8_t *out) {
+    int x = 0;
+#ifdef MIP_SSE2
+    if (srcWidth >= 2) {
+        // 4 output texels from 8 texels of each row
+        const __m128i zero = _mm_setzero_si128(), two = _mm_set1_epi16(2);
+        for (; x + 4 <= width; x += 4) {
+            __m128i a0 = _mm_loadu_si128((const __m128i *)(row0 + x * 8));
+            __m128i a1 = _mm_loadu_si128((const __m128i *)(row0 + x * 8 + 16));
+            __m128i b0 = _mm_loadu_si128((const __m128i *)(row1 + x * 8));
+            __m128i b1 = _mm_loadu_si128((const __m128i *)(row1 + x * 8 + 16));
+            // 16 bit sums of vertical pairs, two texels per half
+            __m128i s0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+            __m128i s1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+            __m128i s2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+            __m128i s3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+            // add horizontal neighbors: low 64 bits of each is one output texel
+            s0 = _mm_add_epi16(s0, _mm_srli_si128(s0, 8));
+            s1 = _mm_add_epi16(s1, _mm_srli_si128(s1, 8));
+            s2 = _mm_add_epi16(s2, _mm_srli_si128(s2, 8));
+            s3 = _mm_add_epi16(s3, _mm_srli_si128(s3, 8));
+            __m128i lo = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(s0, s1), two), 2);
+            __m128i hi = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(s2, s3), two), 2);
+            _mm_storeu_si128((__m128i *)(out + x * 4), _mm_packus_epi16(lo, hi));
+        }
+    }
+#endif
+    for (; x < width; x++) {
+        int x0 = x * 2, x1 = std::min(x0 + 1, srcWidth - 1);
+        for (int c = 0; c < 4; c++) {
+            int sum = row0[x0 * 4 + c] + row0[x1 * 4 + c] + row1[x0 * 4 + c] + row1[x1 * 4 + c];
+            out[x * 4 + c] = (uint8_t)((sum + 2) >> 2);
+        }
+    }
+}
+
+static void gammaRow(const uint8_t *row0, const uint8_t *row1, int srcWidth, int width,
+        uint8_t *out) {
+    const GammaTables &tables = gammaTables();
+    for (int x = 0; x < width; x++) {
+        int x0 = x * 2, x1 = std::min(x0 + 1, srcWidth - 1);
+        const uint8_t *t[4] = {row0 + x0 * 4, row0 + x1 * 4, row1 + x0 * 4, row1 + x1 * 4};
+        for (int c = 0; c < 3; c++) {
+            uint32_t sum = tables.toLinear[t[0][c]] + tables.toLinear[t[1][c]]
+                + tables.toLinear[t[2][c]] + tables.toLinear[t[3][c]];
+            out[x * 4 + c] = tables.toSrgb[(sum + 2) >> 2];
+        }
+        out[x * 4 + 3] = (uint8_t)((t[0][3] + t[1][3] + t[2][3] + t[3][3] + 2) >> 2);
+    }
+}
+
+void downsample(const Image &src, MipFilter filter, Image *dst) {
+    dst->width = std::max(1, src.width / 2);
+    dst->height = std::max(1, src.height / 2);
+    dst->pixels.resize((size_t)dst->width * dst->height * 4);
+    if (filter == MIP_GAMMA)
+        gammaTables(); // build before the threads start
+    // around 64K texels per thread
+    size_t minRows = std::max(1, 65536 / dst->width);
+    parallelFor(dst->height, [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; y++) {
+            int y0 = (int)y * 2, y1 = std::min(y0 + 1, src.height - 1);
+            const uint8_t *row0 = src.pixel(0, y0), *row1 = src.pixel(0, y1);
+            uint8_t *out = dst->pixel(0, (int)y);
+            if (filter == MIP_GAMMA)
+                gammaRow(row0, row1, src.width, dst->width, out);
+            else
+                boxRow(row0, row1, src.width, dst->width, out);
+        }
+    }, minRows);
+}
+
+void generateMips(Image base, MipFilter filter, std::vector<Image> *levels) {
+    levels->clear();
+    levels->push_back(std::move(base));
+    while (levels->back().width > 1 || levels->back().height > 1) {
+        Image next;
+        downsample(levels->back(), filter, &next);
+        levels->push_back(std::move(next));
+    }
+}
+
+} // namespace
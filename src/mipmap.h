@@ -0,0 +1,20 @@
+#pragma once
+#include <common.h>
+
+#include "image.h"
+#include <vector>
+
+namespace winged {
+
+enum MipFilter {
+    MIP_BOX, // average of 2x2 texels as stored
+    MIP_GAMMA // average in linear light, treating color as sRGB. alpha is averaged as stored
+};
+
+// half the size (rounded down, at least 1). odd rows and columns at the edge are dropped
+void downsample(const Image &src, MipFilter filter, Image *dst);
+// levels[0] is base, each following level is half the size of the previous, down to 1x1.
+// rows of each level are split between threads
+void generateMips(Image base, MipFilter filter, std::vector<Image> *levels);
+
+} // namespace
@@ -0,0 +1,301 @@
+#include "modifiers.h"
+#include "operations.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cwchar>
+#include <glm/glm/geometric.hpp>
+
+namespace winged {
+
+void MirrorModifier::build(const Surface &input, Surface *output) {
+    copySurface(output, input);
+    appendSurface(output, input, true); // reflection flips orientation
+    updatePositions(input, output);
+}
+
+void MirrorModifier::updatePositions(const Surface &input, Surface *output) {
+    size_t numVerts = input.vertices.size();
+    parallelFor(numVerts, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            glm::vec3 pos = input.vertices[i]->pos;
+            output->vertices[i]->pos = pos;
+            pos[axis] = -pos[axis];
+            output->vertices[numVerts + i]->pos = pos;
+        }
+    });
+}
+
+void ArrayModifier::build(const Surface &input, Surface *output) {
+    copySurface(output, input);
+    for (int i = 1; i < count; i++)
+        appendSurface(output, input);
+    updatePositions(input, output);
+}
+
+void ArrayModifier::updatePositions(const Surface &input, Surface *output) {
+    size_t numVerts = input.vertices.size();
+    for (int copy = 0; copy < count; copy++) {
+        glm::vec3 copyOffset = offset * (float)copy;
+        size_t outBase = numVerts * copy;
+        parallelFor(numVerts, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+                output->vertices[outBase + i]->pos = input.vertices[i]->pos + copyOffset;
+        });
+    }
+}
+
+// output vertices are: input vertices, then one per face, then one per edge (twin pair)
+static void numberEdges(const Surface &input, std::vector<int> *edgePoints) {
+    edgePoints->resize(input.edges.size());
+    int next = 0;
+    for (auto &edge : input.edges) {
+        if (edge->primary() == edge.get()) {
+            (*edgePoints)[edge->index] = next;
+            (*edgePoints)[edge->twin->index] = next;
+            next++;
+        }
+    }
+}
+
+static void subdividePositions(const Surface &input, Surface *output) {
+    size_t numVerts = input.vertices.size(), numFaces = input.faces.size();
+    std::vector<int> edgePoints;
+    numberEdges(input, &edgePoints);
+    auto outPos = [&](size_t i) -> glm::vec3 & { return output->vertices[i]->pos; };
+
+    std::vector<glm::vec3> facePoints(numFaces);
+    parallelFor(numFaces, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            glm::vec3 sum(0);
+            int count = 0;
+            for (ITER_FACE_EDGES(input.faces[i], faceEdge)) {
+                sum += faceEdge->vert->pos;
+                count++;
+            }
+            facePoints[i] = sum / (float)count;
+            outPos(numVerts + i) = facePoints[i];
+        }
+    });
+    parallelFor(input.edges.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            HEdge *edge = input.edges[i].get();
+            if (edge->primary() != edge)
+                continue;
+            outPos(numVerts + numFaces + edgePoints[i]) = (edge->vert->pos
+                + edge->twin->vert->pos + facePoints[edge->face->index]
+                + facePoints[edge->twin->face->index]) / 4.0f;
+        }
+    });
+    parallelFor(numVerts, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            Vertex *vert = input.vertices[i].get();
+            glm::vec3 faceSum(0), midSum(0);
+            int valence = 0;
+            for (ITER_VERTEX_EDGES(vert, vertEdge)) {
+                faceSum += facePoints[vertEdge->face->index];
+                midSum += (vert->pos + vertEdge->twin->vert->pos) / 2.0f;
+                valence++;
+            }
+            float n = (float)valence;
+            outPos(i) = (faceSum / n + midSum / n * 2.0f + vert->pos * (n - 3)) / n;
+        }
+    });
+}
+
+// false if buildSurface can't represent the result, eg. for spur edges left by addFaceVertex
+static bool subdivideTopology(const Surface &input, Surface *output) {
+    size_t numVerts = input.vertices.size(), numFaces = input.faces.size();
+    std::vector<int> edgePoints;
+    numberEdges(input, &edgePoints);
+    int edgeBase = (int)(numVerts + numFaces);
+
+    // positions are filled in afterwards
+    std::vector<glm::vec3> positions(numVerts + numFaces + input.edges.size() / 2);
+    std::vector<int> faceSizes(input.edges.size(), 4), faceVerts;
+    faceVerts.reserve(input.edges.size() * 4);
+    for (auto &face : input.faces) {
+        for (ITER_FACE_EDGES(face, faceEdge)) {
+            faceVerts.push_back((int)faceEdge->vert->index);
+            faceVerts.push_back(edgeBase + edgePoints[faceEdge->index]);
+            faceVerts.push_back((int)(numVerts + face->index));
+            faceVerts.push_back(edgeBase + edgePoints[faceEdge->prev->index]);
+        }
+    }
+    output->vertices.clear();
+    output->faces.clear();
+    output->edges.clear();
+    return buildSurface(output, positions, faceSizes, faceVerts);
+}
+
+void SubdivideModifier::build(const Surface &input, Surface *output) {
+    passThrough = levels < 1;
+    if (passThrough) {
+        copySurface(output, input);
+        return;
+    }
+    intermediate.resize(levels - 1);
+    const Surface *src = &input;
+    for (int level = 0; level < levels; level++) {
+        Surface *dst = output;
+        if (level < levels - 1) {
+            if (!intermediate[level])
+                intermediate[level] = std::make_unique<Surface>();
+            dst = intermediate[level].get();
+        }
+        if (!subdivideTopology(*src, dst)) {
+            wprintf(L"Can't subdivide this surface!\n");
+            passThrough = true;
+            copySurface(output, input);
+            return;
+        }
+        subdividePositions(*src, dst);
+        src = dst;
+    }
+}
+
+void SubdivideModifier::updatePositions(const Surface &input, Surface *output) {
+    if (passThrough) {
+        for (size_t i = 0; i < input.vertices.size(); i++)
+            output->vertices[i]->pos = input.vertices[i]->pos;
+        return;
+    }
+    const Surface *src = &input;
+    for (int level = 0; level < levels; level++) {
+        Surface *dst = level < levels - 1 ? intermediate[level].get() : output;
+        subdividePositions(*src, dst);
+        src = dst;
+    }
+}
+
+void SolidifyModifier::build(const Surface &input, Surface *output) {
+    copySurface(output, input);
+    appendSurface(output, input, true); // inner shell faces inward
+    updatePositions(input, output);
+}
+
+void SolidifyModifier::updatePositions(const Surface &input, Surface *output) {
+    size_t numVerts = input.vertices.size();
+    std::vector<glm::vec3> faceNormals(input.faces.size());
+    parallelFor(input.faces.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            faceNormals[i] = input.faces[i]->normalNonUnit(); // area weighted
+    });
+    parallelFor(numVerts, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            Vertex *vert = input.vertices[i].get();
+            glm::vec3 normal(0);
+            for (ITER_VERTEX_EDGES(vert, vertEdge))
+                normal += faceNormals[vertEdge->face->index];
+            float length = glm::length(normal);
+            if (length > 0)
+                normal /= length;
+            output->vertices[i]->pos = vert->pos;
+            output->vertices[numVerts + i]->pos = vert->pos - normal * thickness;
+        }
+    });
+}
+
+static ModifierStack::Dirty maxDirty(ModifierStack::Dirty a, ModifierStack::Dirty b) {
+    return a > b ? a : b;
+}
+
+ModifierStack::~ModifierStack() {
+    join();
+}
+
+void ModifierStack::add(std::unique_ptr<Modifier> modifier) {
+    join();
+    Stage &stage = stages.emplace_back();
+    stage.modifier = std::move(modifier);
+    pendingStages.push_back(TOPOLOGY);
+}
+
+void ModifierStack::clear() {
+    join();
+    stages.clear();
+    pendingStages.clear();
+    shown.reset();
+}
+
+void ModifierStack::invalidateBase(Dirty dirty) {
+    pendingBase = maxDirty(pendingBase, dirty);
+}
+
+void ModifierStack::invalidate(int stage, Dirty dirty) {
+    pendingStages[stage] = maxDirty(pendingStages[stage], dirty);
+}
+
+void ModifierStack::snapshot(const Surface &base) {
+    if (pendingBase == TOPOLOGY) {
+        copySurface(&baseCopy, base);
+    } else if (pendingBase == POSITIONS) {
+        parallelFor(base.vertices.size(), [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+                baseCopy.vertices[i]->pos = base.vertices[i]->pos;
+        });
+    }
+    baseDirty = maxDirty(baseDirty, pendingBase);
+    pendingBase = CLEAN;
+    for (size_t i = 0; i < stages.size(); i++) {
+        stages[i].dirty = maxDirty(stages[i].dirty, pendingStages[i]);
+        pendingStages[i] = CLEAN;
+    }
+}
+
+void ModifierStack::run() {
+    // dirtiness flows downstream: a stage is at least as dirty as anything before it
+    Dirty dirty = baseDirty;
+    const Surface *input = &baseCopy;
+    for (auto &stage : stages) {
+        dirty = maxDirty(dirty, stage.dirty);
+        if (dirty == TOPOLOGY)
+            stage.modifier->build(*input, &stage.output);
+        else if (dirty == POSITIONS)
+            stage.modifier->updatePositions(*input, &stage.output);
+        stage.dirty = CLEAN;
+        input = &stage.output;
+    }
+    baseDirty = CLEAN;
+}
+
+const Surface & ModifierStack::evaluate(const Surface &base) {
+    join();
+    snapshot(base);
+    run();
+    return stages.empty() ? baseCopy : stages.back().output;
+}
+
+bool ModifierStack::evaluateAsync(const Surface &base) {
+    if (worker.joinable()) {
+        if (!workerDone)
+            return false;
+        join();
+    }
+    snapshot(base);
+    workerDone = false;
+    worker = std::thread([this]() {
+        run();
+        // copy so the viewport can keep drawing it while the stages are re-evaluated
+        auto copy = std::make_unique<Surface>();
+        copySurface(copy.get(), stages.empty() ? baseCopy : stages.back().output);
+        finished = std::move(copy);
+        workerDone = true;
+    });
+    return true;
+}
+
+const Surface * ModifierStack::result() {
+    if (worker.joinable() && workerDone)
+        join();
+    return shown.get();
+}
+
+void ModifierStack::join() {
+    if (worker.joinable()) {
+        worker.join();
+        if (finished)
+            shown = std::move(finished);
+    }
+}
+
+} // namespace
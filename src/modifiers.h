@@ -0,0 +1,117 @@
+#pragma once
+#include <common.h>
+
+#include "surface.h"
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <glm/glm/vec3.hpp>
+
+namespace winged {
+
+// non-destructive operation from an input surface to a new output surface
+class Modifier {
+public:
+    virtual ~Modifier() = default;
+    // rebuild output from scratch
+    virtual void build(const Surface &input, Surface *output) = 0;
+    // input vertices moved but connectivity is the same as the last build
+    virtual void updatePositions(const Surface &input, Surface *output) = 0;
+};
+
+// input plus a reflected copy. each half stays a separate closed shell
+class MirrorModifier : public Modifier {
+public:
+    int axis = 0;
+
+    void build(const Surface &input, Surface *output) override;
+    void updatePositions(const Surface &input, Surface *output) override;
+};
+
+class ArrayModifier : public Modifier {
+public:
+    int count = 2; // changing requires TOPOLOGY
+    glm::vec3 offset = glm::vec3(3, 0, 0); // changing requires POSITIONS
+
+    void build(const Surface &input, Surface *output) override;
+    void updatePositions(const Surface &input, Surface *output) override;
+};
+
+// Catmull-Clark
+class SubdivideModifier : public Modifier {
+public:
+    int levels = 1;
+
+    void build(const Surface &input, Surface *output) override;
+    void updatePositions(const Surface &input, Surface *output) override;
+
+private:
+    std::vector<std::unique_ptr<Surface>> intermediate; // levels - 1
+    bool passThrough = false; // output is a copy of the input, as of the last build
+};
+
+// adds an inner shell offset along vertex normals, facing inward
+class SolidifyModifier : public Modifier {
+public:
+    float thickness = 0.1f; // changing requires POSITIONS
+
+    void build(const Surface &input, Surface *output) override;
+    void updatePositions(const Surface &input, Surface *output) override;
+};
+
+// output of each modifier is cached and only re-evaluated when it or something upstream changed.
+// moving vertices of the base (POSITIONS) never rebuilds connectivity of later stages
+class ModifierStack {
+public:
+    enum Dirty {
+        CLEAN = 0,
+        POSITIONS = 1,
+        TOPOLOGY = 2
+    };
+
+    ~ModifierStack();
+
+    void add(std::unique_ptr<Modifier> modifier);
+    void clear(); // remove all modifiers and results
+    int size() const { return (int)stages.size(); }
+    Modifier * modifier(int i) { return stages[i].modifier.get(); }
+
+    void invalidateBase(Dirty dirty); // base surface changed
+    void invalidate(int stage, Dirty dirty); // parameters of a modifier changed
+
+    // blocking, waits for any background evaluation first
+    const Surface & evaluate(const Surface &base);
+    // snapshot the base, then evaluate on a background thread.
+    // returns false (and does nothing) if an evaluation is already running
+    bool evaluateAsync(const Surface &base);
+    // most recent finished background result, null if there is none yet. the previous result
+    // stays available while a new one is being evaluated
+    const Surface * result();
+    // a background evaluation hasn't finished yet
+    bool evaluating() const { return worker.joinable() && !workerDone; }
+
+private:
+    struct Stage {
+        std::unique_ptr<Modifier> modifier;
+        Surface output;
+        Dirty dirty = TOPOLOGY;
+    };
+    // only touched by the worker while it is running
+    std::vector<Stage> stages;
+    Surface baseCopy;
+    Dirty baseDirty = TOPOLOGY;
+    // requested changes, applied to the stages before the next evaluation
+    Dirty pendingBase = TOPOLOGY;
+    std::vector<Dirty> pendingStages;
+
+    std::thread worker;
+    std::atomic<bool> workerDone {false};
+    std::unique_ptr<Surface> finished, shown;
+
+    void snapshot(const Surface &base);
+    void run();
+    void join();
+};
+
+} // namespace
@@ -0,0 +1,88 @@
+#include "objfile.h"
+#include "operations.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cwchar>
+#include <vector>
+
+namespace winged {
+
+bool readObj(Surface *surface, const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        wprintf(L"Couldn't open file!\n");
+        return false;
+    }
+    std::vector<glm::vec3> positions;
+    std::vector<int> faceSizes, faceVerts;
+    char line[4096];
+    int lineNum = 0;
+    bool valid = true;
+    while (valid && fgets(line, sizeof(line), file)) {
+        lineNum++;
+        char *c = line;
+        if (c[0] == 'v' && (c[1] == ' ' || c[1] == '\t')) {
+            glm::vec3 pos;
+            c++;
+            for (int i = 0; i < 3; i++) {
+                char *end;
+                pos[i] = strtof(c, &end);
+                if (end == c)
+                    valid = false;
+                c = end;
+            }
+            positions.push_back(pos);
+        } else if (c[0] == 'f' && (c[1] == ' ' || c[1] == '\t')) {
+            c++;
+            int size = 0;
+            while (true) {
+                char *end;
+                long index = strtol(c, &end, 10);
+                if (end == c)
+                    break;
+                // relative to the end of the list so far
+                if (index < 0)
+                    index += (long)positions.size() + 1;
+                faceVerts.push_back((int)index - 1);
+                size++;
+                // skip texture coordinate / normal indices
+                for (c = end; *c && *c != ' ' && *c != '\t'; c++) {}
+            }
+            faceSizes.push_back(size);
+        }
+    }
+    fclose(file);
+    if (!valid) {
+        wprintf(L"Invalid vertex on line %d!\n", lineNum);
+        return false;
+    }
+
+    surface->vertices.clear();
+    surface->faces.clear();
+    surface->edges.clear();
+    return buildSurface(surface, positions, faceSizes, faceVerts);
+}
+
+bool writeObj(const Surface &surface, const char *path) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        wprintf(L"Couldn't open file for writing!\n");
+        return false;
+    }
+    for (auto &vert : surface.vertices)
+        fprintf(file, "v %.9g %.9g %.9g\n", vert->pos.x, vert->pos.y, vert->pos.z);
+    for (auto &face : surface.faces) {
+        fputc('f', file);
+        for (ITER_FACE_EDGES(face, faceEdge))
+            fprintf(file, " %zu", faceEdge->vert->index + 1);
+        fputc('\n', file);
+    }
+    bool ok = !ferror(file);
+    if (fclose(file) != 0)
+        ok = false;
+    if (!ok)
+        wprintf(L"Error writing file!\n");
+    return ok;
+}
+
+} // namespace
@@ -0,0 +1,13 @@
+#pragma once
+#include <common.h>
+
+#include "surface.h"
+
+namespace winged {
+
+// Wavefront OBJ, positions and faces only. texture coordinates, normals, groups and materials
+// are ignored. faces must form a closed surface (see buildSurface)
+bool readObj(Surface *surface, const char *path); // replaces contents
+bool writeObj(const Surface &surface, const char *path);
+
+} // namespace
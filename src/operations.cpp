@@ -0,0 +1,596 @@
+#include "operations.h"
+#include "polygon.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cwchar>
+#include <unordered_set>
+#include <glm/glm/common.hpp>
+
+namespace winged {
+
+void linkTwins(HEdge *edge1, HEdge *edge2) {
+    edge1->twin = edge2;
+    edge2->twin = edge1;
+}
+
+void linkNext(HEdge *prev, HEdge *next) {
+    prev->next = next;
+    next->prev = prev;
+}
+
+void makeCube(Surface *surface) {
+    for (int i = 0; i < 8; i++) {
+        Vertex *vertex = surface->newVertex();
+        vertex->pos.x = (i & 0x1) ? 1.0f : -1.0f;
+        vertex->pos.y = (i & 0x2) ? 1.0f : -1.0f;
+        vertex->pos.z = (i & 0x4) ? 1.0f : -1.0f;
+    }
+
+    HEdge *edges[6][4]; // counter-clockwise order
+    for (int i = 0; i < 6; i++) {
+        Face *face = surface->newFace();
+        for (int j = 0; j < 4; j++) {
+            HEdge *edge = surface->newEdge();
+            edges[i][j] = edge;
+            edge->face = face;
+        }
+        face->edge = edges[i][0];
+        for (int j = 0; j < 3; j++)
+            linkNext(edges[i][j], edges[i][j + 1]);
+        linkNext(edges[i][3], edges[i][0]);
+    }
+
+    // normal (-1, 0, 0)         0bZYX
+    edges[0][0]->vert = surface->vertices[0b000].get();  linkTwins(edges[0][0], edges[2][3]);
+    edges[0][1]->vert = surface->vertices[0b100].get();  linkTwins(edges[0][1], edges[5][3]);
+    edges[0][2]->vert = surface->vertices[0b110].get();
+    edges[0][3]->vert = surface->vertices[0b010].get();
+    // normal (1, 0, 0)
+    edges[1][0]->vert = surface->vertices[0b001].get();  linkTwins(edges[1][0], edges[4][2]);
+    edges[1][1]->vert = surface->vertices[0b011].get();  linkTwins(edges[1][1], edges[3][2]);
+    edges[1][2]->vert = surface->vertices[0b111].get();
+    edges[1][3]->vert = surface->vertices[0b101].get();
+    // normal (0, -1, 0)
+    edges[2][0]->vert = surface->vertices[0b000].get();  linkTwins(edges[2][0], edges[4][3]);
+    edges[2][1]->vert = surface->vertices[0b001].get();  linkTwins(edges[2][1], edges[1][3]);
+    edges[2][2]->vert = surface->vertices[0b101].get();
+    edges[2][3]->vert = surface->vertices[0b100].get();
+    // normal (0, 1, 0)
+    edges[3][0]->vert = surface->vertices[0b010].get();  linkTwins(edges[3][0], edges[0][2]);
+    edges[3][1]->vert = surface->vertices[0b110].get();  linkTwins(edges[3][1], edges[5][2]);
+    edges[3][2]->vert = surface->vertices[0b111].get();
+    edges[3][3]->vert = surface->vertices[0b011].get();
+    // normal (0, 0, -1)
+    edges[4][0]->vert = surface->vertices[0b000].get();  linkTwins(edges[4][0], edges[0][3]);
+    edges[4][1]->vert = surface->vertices[0b010].get();  linkTwins(edges[4][1], edges[3][3]);
+    edges[4][2]->vert = surface->vertices[0b011].get();
+    edges[4][3]->vert = surface->vertices[0b001].get();
+    // normal (0, 0, 1)
+    edges[5][0]->vert = surface->vertices[0b100].get();  linkTwins(edges[5][0], edges[2][2]);
+    edges[5][1]->vert = surface->vertices[0b101].get();  linkTwins(edges[5][1], edges[1][2]);
+    edges[5][2]->vert = surface->vertices[0b111].get();
+    edges[5][3]->vert = surface->vertices[0b110].get();
+
+    for (int i = 4; i < 6; i++)
+        for (int j = 0; j < 4; j++)
+            edges[i][j]->vert->edge = edges[i][j];
+}
+
+bool buildSurface(Surface *surface, const std::vector<glm::vec3> &positions,
+        const std::vector<int> &faceSizes, const std::vector<int> &faceVerts) {
+    size_t oldVerts = surface->vertices.size(), oldFaces = surface->faces.size(),
+        oldEdges = surface->edges.size();
+    auto fail = [&](const wchar_t *message) {
+        wprintf(L"%ls\n", message);
+        // everything was appended, so this removes it
+        surface->vertices.resize(oldVerts);
+        surface->faces.resize(oldFaces);
+        surface->edges.resize(oldEdges);
+        return false;
+    };
+
+    std::vector<char> referenced(positions.size(), 0);
+    for (int v : faceVerts) {
+        if (v < 0 || v >= (int)positions.size())
+            return fail(L"Face vertex index out of range!");
+        referenced[v] = 1;
+    }
+    std::vector<Vertex *> verts(positions.size(), nullptr);
+    for (size_t i = 0; i < positions.size(); i++) {
+        if (referenced[i]) {
+            verts[i] = surface->newVertex();
+            verts[i]->pos = positions[i];
+        }
+    }
+
+    // edges sorted by their (unordered) pair of vertices end up next to their twins. faster than
+    // a hash map for large surfaces
+    struct EdgeKey {
+        uint64_t key;
+        HEdge *edge;
+        bool forward; // from < to
+    };
+    std::vector<EdgeKey> keys;
+    keys.reserve(faceVerts.size());
+    size_t start = 0;
+    for (int size : faceSizes) {
+        if (size < 3)
+            return fail(L"Face has less than three vertices!");
+        if (start + size > faceVerts.size())
+            return fail(L"Face vertex index out of range!");
+        Face *face = surface->newFace();
+        HEdge *first = nullptr, *prev = nullptr;
+        for (int i = 0; i < size; i++) {
+            int from = faceVerts[start + i], to = faceVerts[start + (i + 1) % size];
+            if (from == to)
+                return fail(L"Edge between single vertex!");
+            HEdge *edge = surface->newEdge();
+            edge->vert = verts[from];
+            edge->face = face;
+            edge->twin = nullptr;
+            verts[from]->edge = edge;
+            if (prev)
+                linkNext(prev, edge);
+            else
+                first = edge;
+            prev = edge;
+            int low = std::min(from, to), high = std::max(from, to);
+            keys.push_back({((uint64_t)low << 32) | (uint32_t)high, edge, from < to});
+        }
+        linkNext(prev, first);
+        face->edge = first;
+        start += size;
+    }
+    std::sort(keys.begin(), keys.end(), [](const EdgeKey &a, const EdgeKey &b) {
+        return a.key < b.key;
+    });
+    for (size_t i = 0; i < keys.size(); i += 2) {
+        if (i + 1 == keys.size() || keys[i + 1].key != keys[i].key)
+            return fail(L"Surface is not closed!");
+        if ((i + 2 < keys.size() && keys[i + 2].key == keys[i].key)
+                || keys[i].forward == keys[i + 1].forward)
+            return fail(L"Edge is shared by more than two faces or faces are not oriented!");
+        linkTwins(keys[i].edge, keys[i + 1].edge);
+    }
+    return true;
+}
+
+void appendSurface(Surface *surface, const Surface &src, bool reverse) {
+    size_t baseVert = surface->vertices.size(), baseFace = surface->faces.size(),
+        baseEdge = surface->edges.size();
+    for (auto &vert : src.vertices)
+        surface->newVertex()->pos = vert->pos;
+    for (size_t i = 0; i < src.faces.size(); i++)
+        surface->newFace();
+    for (size_t i = 0; i < src.edges.size(); i++)
+        surface->newEdge();
+    auto vertCopy = [&](const Vertex *v) { return surface->vertices[baseVert + v->index].get(); };
+    auto faceCopy = [&](const Face *f) { return surface->faces[baseFace + f->index].get(); };
+    auto edgeCopy = [&](const HEdge *e) { return surface->edges[baseEdge + e->index].get(); };
+
+    for (auto &vert : src.vertices) {
+        // reversed edges start where the original ends
+        vertCopy(vert.get())->edge = edgeCopy(reverse ? vert->edge->prev : vert->edge);
+    }
+    for (auto &face : src.faces)
+        faceCopy(face.get())->edge = edgeCopy(face->edge);
+    for (auto &edge : src.edges) {
+        HEdge *copy = edgeCopy(edge.get());
+        copy->twin = edgeCopy(edge->twin);
+        copy->face = faceCopy(edge->face);
+        if (reverse) {
+            copy->vert = vertCopy(edge->next->vert);
+            copy->next = edgeCopy(edge->prev);
+            copy->prev = edgeCopy(edge->next);
+        } else {
+            copy->vert = vertCopy(edge->vert);
+            copy->next = edgeCopy(edge->next);
+            copy->prev = edgeCopy(edge->prev);
+        }
+    }
+}
+
+void copySurface(Surface *surface, const Surface &src) {
+    surface->vertices.clear();
+    surface->faces.clear();
+    surface->edges.clear();
+    appendSurface(surface, src);
+}
+
+// for debugging only!!
+bool validateSurface(Surface *surface) {
+    const uint32_t UNINITIALIZED = 0xCDCDCDCD; // used by MSVC debugging runtime
+    float UNINITIALIZED_FLOAT;
+    memcpy(&UNINITIALIZED_FLOAT, &UNINITIALIZED, sizeof(UNINITIALIZED_FLOAT));
+
+    bool valid = true;
+    std::unordered_set<Vertex *> vertices;
+    std::unordered_set<Face *> faces;
+    std::unordered_set<HEdge *> edges;
+    for (auto &v : surface->vertices)
+        vertices.insert(v.get());
+    if (vertices.size() < surface->vertices.size()) {
+        wprintf(L"Surface contains duplicate vertex entries!\n");
+        valid = false;
+    }
+    for (auto &f : surface->faces)
+        faces.insert(f.get());
+    if (faces.size() < surface->faces.size()) {
+        wprintf(L"Surface contains duplicate face entries!\n");
+        valid = false;
+    }
+    for (auto &e : surface->edges)
+        edges.insert(e.get());
+    if (edges.size() < surface->edges.size()) {
+        wprintf(L"Surface contains duplicate edge entries!\n");
+        valid = false;
+    }
+
+    for (auto &v : surface->vertices) {
+        if (!edges.count(v->edge)) {
+            wprintf(L"Vertex has invalid edge reference!\n");
+            valid = false;
+        } else {
+            for (ITER_VERTEX_EDGES(v, vertEdge)) {
+                if (vertEdge->vert != v.get()) {
+                    wprintf(L"Edge attached to vertex does not reference vertex!\n");
+                    valid = false;
+                }
+            }
+        }
+        if (v->pos.x == UNINITIALIZED_FLOAT || v->pos.y == UNINITIALIZED_FLOAT
+                || v->pos.z == UNINITIALIZED_FLOAT) {
+            wprintf(L"Vertex position is uninitialized!\n");
+            valid = false;
+        } else {
+            glm::vec3 absPos = glm::abs(v->pos);
+            if (absPos.x > 1000000 || absPos.y > 1000000 || absPos.z > 1000000)
+                wprintf(L"Vertex has a very large coordinate, may be uninitialized! (%f, %f, %f)\n",
+                    v->pos.x, v->pos.y, v->pos.z);
+        }
+    }
+
+    for (auto &f : surface->faces) {
+        if (!edges.count(f->edge)) {
+            wprintf(L"Face has invalid edge reference!\n");
+            valid = false;
+        } else {
+            for (ITER_FACE_EDGES(f, faceEdge)) {
+                if (faceEdge->face != f.get()) {
+                    wprintf(L"Edge attached to face does not reference face!\n");
+                    valid = false;
+                }
+            }
+            if (f->edge->next->next == f->edge) {
+                wprintf(L"Face only has two edges!\n");
+                valid = false;
+            }
+        }
+    }
+
+    for (auto &e : surface->edges) {
+        if (!edges.count(e->twin)) {
+            wprintf(L"Edge has invalid twin reference!\n");
+            valid = false;
+        } else {
+            if (e->twin == e.get()) {
+                wprintf(L"Edge's twin is itself!\n");
+                valid = false;
+            } else if (e->twin->twin != e.get()) {
+                wprintf(L"Edges are not twins!\n");
+                valid = false;
+            }
+        }
+        if (!edges.count(e->next)) {
+            wprintf(L"Edge has invalid next reference!\n");
+            valid = false;
+        } else {
+            if (e->next == e.get()) {
+                wprintf(L"Edge's next link is itself!\n");
+                valid = false;
+            } else if (e->next->prev != e.get()) {
+                wprintf(L"Edges are not linked!\n");
+                valid = false;
+            }
+        }
+        if (!edges.count(e->prev)) {
+            wprintf(L"Edge has invalid prev reference!\n");
+            valid = false;
+        } else {
+            if (e->prev == e.get()) {
+                wprintf(L"Edge's prev link is itself!\n");
+                valid = false;
+            }
+        }
+        if (!faces.count(e->face)) {
+            wprintf(L"Edge has invalid face reference!\n");
+            valid = false;
+        } else {
+            bool foundEdge = false;
+            for (ITER_FACE_EDGES(e->face, faceEdge)) {
+                if (faceEdge == e.get()) {
+                    foundEdge = true;
+                    break;
+                }
+            }
+            if (!foundEdge) {
+                wprintf(L"Edge cannot be reached from face!\n");
+                valid = false;
+            }
+        }
+        if (!vertices.count(e->vert)) {
+            wprintf(L"Edge has invalid vertex reference!\n");
+            valid = false;
+        } else {
+            bool foundEdge = false;
+            for (ITER_VERTEX_EDGES(e->vert, vertEdge)) {
+                if (vertEdge == e.get()) {
+                    foundEdge = true;
+                    break;
+                }
+            }
+            if (!foundEdge) {
+                wprintf(L"Edge cannot be reached from vertex!\n");
+                valid = false;
+            }
+            if (e->vert == e->twin->vert) {
+                wprintf(L"Edge between single vertex!\n");
+                valid = false;
+            }
+        }
+    }
+
+    if (!valid)
+        wprintf(L"== Surface is not valid ==\n");
+    return valid;
+}
+
+bool splitEdge(Surface *surface, HEdge *edge) {
+    HEdge *newEdge = surface->newEdge();
+    HEdge *newTwin = surface->newEdge();
+    linkTwins(newEdge, newTwin);
+
+    // insert newEdge between edge and edge->next
+    HEdge *next = edge->next, *twinPrev = edge->twin->prev;
+    linkNext(newEdge, next);
+    linkNext(twinPrev, newTwin);
+    linkNext(edge, newEdge);
+    linkNext(newTwin, edge->twin);
+
+    Vertex *newVert = surface->newVertex();
+    newVert->pos = (edge->vert->pos + edge->twin->vert->pos) / 2.0f;
+    newVert->edge = newEdge;
+
+    newEdge->vert = newVert;
+    newTwin->vert = edge->twin->vert;
+    newTwin->vert->edge = newTwin; // in case it was edge->twin
+    edge->twin->vert = newVert;
+
+    newEdge->face = edge->face;
+    newTwin->face = edge->twin->face;
+    return true;
+}
+
+bool splitFace(Surface *surface, HEdge *e1, HEdge *e2) {
+    if (e1->face != e2->face) {
+        wprintf(L"Edges must share a common face!\n");
+        return false;
+    } else if (e1->next == e2 || e2->next == e1) {
+        wprintf(L"Edge already exists between these vertices!\n");
+        return false;
+    }
+
+    HEdge *newEdge1 = surface->newEdge();
+    HEdge *newEdge2 = surface->newEdge();
+    linkTwins(newEdge1, newEdge2);
+
+    newEdge1->vert = e1->vert;
+    newEdge2->vert = e2->vert;
+
+    HEdge *e1Prev = e1->prev, *e2Prev = e2->prev;
+    linkNext(newEdge1, e2);
+    linkNext(newEdge2, e1);
+    linkNext(e1Prev, newEdge1);
+    linkNext(e2Prev, newEdge2);
+
+    newEdge1->face = e1->face;
+    newEdge1->face->edge = newEdge1;
+    Face *newFace = surface->newFace();
+    newFace->edge = newEdge2;
+    for (ITER_FACE_EDGES(newFace, newFaceEdge))
+        newFaceEdge->face = newFace;
+    return true;
+}
+
+bool addFaceVertex(Surface *surface, HEdge *edge) {
+    HEdge *newEdge = surface->newEdge();
+    HEdge *newTwin = surface->newEdge();
+    linkTwins(newEdge, newTwin);
+
+    linkNext(newTwin, newEdge);
+    linkNext(edge->prev, newTwin);
+    linkNext(newEdge, edge);
+
+    Vertex *newVert = surface->newVertex();
+    newVert->pos = edge->vert->pos;
+    newVert->edge = newEdge;
+
+    newEdge->vert = newVert;
+    newTwin->vert = edge->vert;
+    newTwin->vert->edge = newTwin; // in case it was edge
+
+    newEdge->face = edge->face;
+    newTwin->face = edge->face;
+    return true;
+}
+
+bool removeTwoSidedFace(Surface *surface, Face *face) {
+    if (face->edge->next->next != face->edge)
+        return false; // face has more than two sides
+    HEdge *edge1 = face->edge, *edge2 = face->edge->next;
+    edge1->vert->edge = edge1->twin->next;
+    edge2->vert->edge = edge2->twin->next;
+    edge1->twin->twin = edge2->twin;
+    edge2->twin->twin = edge1->twin;
+    surface->deleteEdge(edge1);
+    surface->deleteEdge(edge2);
+    surface->deleteFace(face);
+    return true;
+}
+
+bool canMergeAlongEdge(HEdge *edge) {
+    // the only neighbors the two vertices may share are the far corners of triangles on either
+    // side of the edge, otherwise merging would pinch the surface
+    int allowed = 0;
+    if (edge->next->next->next == edge)
+        allowed++;
+    if (edge->twin->next->next->next == edge->twin)
+        allowed++;
+    int shared = 0;
+    for (ITER_VERTEX_EDGES(edge->vert, e1)) {
+        for (ITER_VERTEX_EDGES(edge->twin->vert, e2)) {
+            if (e1->twin->vert == e2->twin->vert)
+                shared++;
+        }
+    }
+    return shared <= allowed;
+}
+
+bool mergeVerticesAlongEdge(Surface *surface, HEdge *edge) {
+    // similar structure to deleteEdge
+    HEdge *twin = edge->twin;
+    Vertex *keepVert = edge->vert, *oldVert = twin->vert;
+    for (ITER_VERTEX_EDGES(oldVert, vertEdge))
+        vertEdge->vert = keepVert;
+    surface->deleteVertex(oldVert);
+
+    if (edge->next == twin) {
+        edge->face->edge = edge->prev;
+        edge->vert->edge = twin->next; // edge->prev is incoming
+    } else {
+        edge->face->edge = edge->next;
+        edge->vert->edge = edge->next;
+    }
+    if (twin->next == edge) {
+        twin->face->edge = twin->prev;
+    } else {
+        twin->face->edge = twin->next;
+    }
+
+    // this works even if prev or next == twin
+    linkNext(edge->prev, edge->next);
+    linkNext(twin->prev, twin->next);
+    // TODO detect if entire solid should be deleted
+    removeTwoSidedFace(surface, edge->face);
+    removeTwoSidedFace(surface, twin->face);
+    surface->deleteEdge(edge);
+    surface->deleteEdge(twin);
+    return true;
+}
+
+// TODO: mergeVerticesOnFace() -- equivalent to splitFace + mergeVerticesAlongEdge
+
+bool deleteEdge(Surface *surface, HEdge *edge) {
+    HEdge *twin = edge->twin;
+    if (edge->face != twin->face) {
+        Face *keepFace = edge->face, *oldFace = twin->face;
+        for (ITER_FACE_EDGES(oldFace, faceEdge))
+            faceEdge->face = keepFace;
+        surface->deleteFace(oldFace);
+    } else if (edge->next != twin && edge->prev != twin) {
+        wprintf(L"Deleting this edge would create a hole in the face!\n");
+        return false;
+    }
+
+    if (edge->next == twin) {
+        surface->deleteVertex(twin->vert);
+        edge->face->edge = edge->prev;
+    } else {
+        twin->vert->edge = edge->next;
+        edge->face->edge = edge->next;
+    }
+    if (twin->next == edge) {
+        surface->deleteVertex(edge->vert);
+    } else {
+        edge->vert->edge = twin->next;
+    }
+
+    linkNext(edge->prev, twin->next);
+    linkNext(twin->prev, edge->next);
+    surface->deleteEdge(edge);
+    surface->deleteEdge(twin);
+    // TODO detect if entire solid should be deleted
+    return true;
+}
+
+bool extrudeFace(Surface *surface, Face *face) {
+    // face will become the top face
+    HEdge *topFirst = nullptr, *topPrev = nullptr;
+    for (ITER_FACE_EDGES(face, baseEdge)) {
+        HEdge *topEdge = surface->newEdge();
+        HEdge *topTwin = surface->newEdge();
+        linkTwins(topEdge, topTwin);
+        HEdge *joinEdge = surface->newEdge();
+        HEdge *joinTwin = surface->newEdge();
+        linkTwins(joinEdge, joinTwin);
+
+        // incomplete side face loop
+        linkNext(topTwin, joinEdge);
+        linkNext(joinEdge, baseEdge);
+        // top face loop
+        if (topPrev)
+            linkNext(topPrev, topEdge);
+        else
+            topFirst = topEdge;
+        topPrev = topEdge;
+
+        Vertex *topVert = surface->newVertex();
+        topVert->pos = baseEdge->vert->pos;
+        topVert->edge = joinEdge;
+        joinEdge->vert = topVert;
+        topEdge->vert = topVert;
+        joinTwin->vert = baseEdge->vert;
+
+        Face *sideFace = surface->newFace();
+        sideFace->edge = joinEdge;
+        joinEdge->face = sideFace;
+        topTwin->face = sideFace;
+        baseEdge->face = sideFace;
+
+        topEdge->face = face;
+    }
+    linkNext(topPrev, topFirst);
+    face->edge = topFirst;
+
+    for (ITER_FACE_EDGES(face, topEdge)) {
+        // complete side face loop
+        linkNext(topEdge->next->twin->next->twin, topEdge->twin);
+        linkNext(topEdge->twin->next->next, topEdge->twin->prev);
+
+        topEdge->twin->prev->face = topEdge->twin->face;
+        topEdge->twin->vert = topEdge->next->vert;
+    }
+    return true;
+}
+
+bool triangulateFace(Surface *surface, Face *face) {
+    std::vector<HEdge *> edges; // edges[i] starts at vertex i of the polygon
+    for (ITER_FACE_EDGES(face, faceEdge))
+        edges.push_back(faceEdge);
+    std::vector<glm::dvec2> points;
+    std::vector<int> triangles;
+    projectFace(face, &points);
+    triangulatePolygon(points, &triangles);
+    // cut off ears (p, i, q) in order by connecting p and q. the ear becomes the new face and
+    // the rest stays in face, now starting with the new edge from p
+    for (size_t t = 0; t + 3 < triangles.size(); t += 3) {
+        int p = triangles[t], q = triangles[t + 2];
+        if (!splitFace(surface, edges[p], edges[q]))
+            return false;
+        edges[p] = edges[q]->prev;
+    }
+    return true;
+}
+
+} // namespace
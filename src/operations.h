@@ -0,0 +1,37 @@
+#pragma once
+#include <common.h>
+
+#include "surface.h"
+#include <vector>
+#include <glm/glm/vec3.hpp>
+
+namespace winged {
+
+void linkTwins(HEdge *edge1, HEdge *edge2);
+void linkNext(HEdge *prev, HEdge *next);
+
+void makeCube(Surface *surface);
+// build from polygons given as counter-clockwise vertex indices, faceSizes[i] indices per face.
+// every edge must be shared by exactly two faces in opposite directions, otherwise returns false
+// and leaves the surface unchanged. unreferenced positions are skipped, others keep their order
+bool buildSurface(Surface *surface, const std::vector<glm::vec3> &positions,
+    const std::vector<int> &faceSizes, const std::vector<int> &faceVerts);
+// append a copy of src. reverse flips the orientation of every face. O(n)
+void appendSurface(Surface *surface, const Surface &src, bool reverse = false);
+void copySurface(Surface *surface, const Surface &src); // replaces contents
+// for debugging only!!
+bool validateSurface(Surface *surface);
+
+// topology operations. return false (and leave the surface unchanged) if not possible
+bool splitEdge(Surface *surface, HEdge *edge); // new vertex is edge->next->vert
+bool splitFace(Surface *surface, HEdge *e1, HEdge *e2); // connect e1->vert and e2->vert
+bool addFaceVertex(Surface *surface, HEdge *edge); // new vertex is edge->prev->vert
+bool removeTwoSidedFace(Surface *surface, Face *face);
+bool mergeVerticesAlongEdge(Surface *surface, HEdge *edge); // keeps edge->vert
+bool canMergeAlongEdge(HEdge *edge); // mergeVerticesAlongEdge would keep the surface manifold
+bool deleteEdge(Surface *surface, HEdge *edge);
+bool extrudeFace(Surface *surface, Face *face);
+// split into triangles by ear clipping, so concave faces work too. O(n) if convex, O(n^2) worst
+bool triangulateFace(Surface *surface, Face *face);
+
+} // namespace
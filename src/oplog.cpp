@@ -0,0 +1,338 @@
+#include "oplog.h"
+#include "memusage.h"
+#include "operations.h"
+#include "weld.h"
+#include <chrono>
+#include <cstring>
+#include <cwchar>
+
+namespace winged {
+
+static const char MAGIC[4] = {'W', 'O', 'P', 'L'};
+static const uint32_t VERSION = 1;
+
+const wchar_t * const OpLog::OP_NAMES[NUM_OPS] = {
+    L"makeCube", L"splitEdge", L"splitFace", L"addFaceVertex", L"mergeVertices", L"deleteEdge",
+    L"extrudeFace", L"moveVertices", L"weld", L"smooth", L"buildSymmetry"
+};
+
+OpLog::~OpLog() {
+    stop();
+}
+
+bool OpLog::record(const char *path) {
+    stop();
+    file = fopen(path, "wb");
+    if (!file) {
+        wprintf(L"Couldn't open log file!\n");
+        return false;
+    }
+    fwrite(MAGIC, 1, sizeof(MAGIC), file);
+    fwrite(&VERSION, sizeof(VERSION), 1, file);
+    fflush(file);
+    return true;
+}
+
+void OpLog::stop() {
+    if (file) {
+        fclose(file);
+        file = nullptr;
+    }
+}
+
+void OpLog::begin(Op op) {
+    buffer.clear();
+    write(op);
+}
+
+void OpLog::flush() {
+    if (!file)
+        return;
+    fwrite(buffer.data(), 1, buffer.size(), file);
+    // if the editor hangs or crashes the log is still complete
+    fflush(file);
+}
+
+bool OpLog::finish(bool ok, const Surface *surface, uint32_t startId) {
+    // a failed operation is normally skipped. but one which created elements before failing
+    // (even if it removed them again) has used up ids and reordered elements, so replaying has
+    // to repeat it or every later operation would be out of step
+    if (ok || surface->nextId != startId)
+        flush();
+    return ok;
+}
+
+void OpLog::makeCube(Surface *surface) {
+    begin(MAKE_CUBE);
+    winged::makeCube(surface);
+    flush();
+}
+
+bool OpLog::splitEdge(Surface *surface, HEdge *edge, Symmetry *symmetry) {
+    uint32_t startId = surface->nextId;
+    begin(SPLIT_EDGE);
+    write((uint8_t)(symmetry != nullptr));
+    writeRef(edge);
+    bool ok = symmetry ? symmetry->splitEdge(surface, edge) : winged::splitEdge(surface, edge);
+    return finish(ok, surface, startId);
+}
+
+bool OpLog::splitFace(Surface *surface, HEdge *e1, HEdge *e2, Symmetry *symmetry) {
+    uint32_t startId = surface->nextId;
+    begin(SPLIT_FACE);
+    write((uint8_t)(symmetry != nullptr));
+    writeRef(e1);
+    writeRef(e2);
+    bool ok = symmetry ? symmetry->splitFace(surface, e1, e2)
+        : winged::splitFace(surface, e1, e2);
+    return finish(ok, surface, startId);
+}
+
+bool OpLog::addFaceVertex(Surface *surface, HEdge *edge) {
+    uint32_t startId = surface->nextId;
+    begin(ADD_FACE_VERTEX);
+    writeRef(edge);
+    bool ok = winged::addFaceVertex(surface, edge);
+    return finish(ok, surface, startId);
+}
+
+bool OpLog::mergeVerticesAlongEdge(Surface *surface, HEdge *edge) {
+    uint32_t startId = surface->nextId;
+    begin(MERGE_VERTICES);
+    writeRef(edge);
+    bool ok = winged::mergeVerticesAlongEdge(surface, edge);
+    return finish(ok, surface, startId);
+}
+
+bool OpLog::deleteEdge(Surface *surface, HEdge *edge) {
+    uint32_t startId = surface->nextId;
+    begin(DELETE_EDGE);
+    writeRef(edge);
+    bool ok = winged::deleteEdge(surface, edge);
+    return finish(ok, surface, startId);
+}
+
+bool OpLog::extrudeFace(Surface *surface, Face *face, Symmetry *symmetry) {
+    uint32_t startId = surface->nextId;
+    begin(EXTRUDE_FACE);
+    write((uint8_t)(symmetry != nullptr));
+    writeRef(face);
+    bool ok = symmetry ? symmetry->extrudeFace(surface, face)
+        : winged::extrudeFace(surface, face);
+    return finish(ok, surface, startId);
+}
+
+void OpLog::moveVertices(const std::vector<std::pair<Vertex *, glm::vec3>> &moves,
+        Symmetry *symmetry) {
+    begin(MOVE_VERTICES);
+    write((uint8_t)(symmetry != nullptr));
+    write((uint32_t)moves.size());
+    for (auto &move : moves) {
+        writeRef(move.first);
+        write(move.second);
+    }
+    if (symmetry) {
+        symmetry->moveVertices(moves);
+    } else {
+        for (auto &move : moves)
+            move.first->pos += move.second;
+    }
+    flush();
+}
+
+int OpLog::weldVertices(Surface *surface, float tolerance) {
+    begin(WELD);
+    write(tolerance);
+    int welded = winged::weldVertices(surface, tolerance);
+    flush();
+    return welded;
+}
+
+void OpLog::smoothSurface(Surface *surface, const SmoothOptions &options,
+        const std::unordered_set<Vertex *> &selection) {
+    begin(SMOOTH);
+    write((uint8_t)options.weights);
+    write((int32_t)options.iterations);
+    write(options.lambda);
+    write((uint8_t)options.taubin);
+    write(options.mu);
+    write((uint32_t)selection.size());
+    for (Vertex *vert : selection)
+        writeRef(vert);
+    winged::smoothSurface(surface, options, selection);
+    flush();
+}
+
+bool OpLog::buildSymmetry(Symmetry *symmetry, Surface *surface) {
+    begin(BUILD_SYMMETRY);
+    write((int32_t)symmetry->axis);
+    write(symmetry->tolerance);
+    bool ok = symmetry->build(surface);
+    if (ok)
+        flush();
+    return ok;
+}
+
+namespace {
+
+struct LogReader {
+    std::vector<uint8_t> data;
+    size_t pos = 0;
+    bool valid = true;
+
+    template<typename T>
+    T read() {
+        T value {};
+        if (pos + sizeof(T) > data.size()) {
+            valid = false;
+            return value;
+        }
+        memcpy(&value, &data[pos], sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+    // look up by index, and check the id to catch a log that doesn't match
+    template<typename T>
+    T * readRef(const std::vector<std::unique_ptr<T>> &elements) {
+        uint32_t index = read<uint32_t>(), id = read<uint32_t>();
+        if (!valid || index >= elements.size() || elements[index]->id != id) {
+            valid = false;
+            return nullptr;
+        }
+        return elements[index].get();
+    }
+};
+
+} // namespace
+
+// false if the operation couldn't be read, not if it failed
+static bool replayOp(LogReader &reader, OpLog::Op op, Surface *surface, Symmetry *symmetry) {
+    Symmetry *opSymmetry = nullptr;
+    if (op == OpLog::SPLIT_EDGE || op == OpLog::SPLIT_FACE || op == OpLog::EXTRUDE_FACE
+            || op == OpLog::MOVE_VERTICES)
+        opSymmetry = reader.read<uint8_t>() ? symmetry : nullptr;
+
+    switch (op) {
+        case OpLog::MAKE_CUBE:
+            makeCube(surface);
+            return true;
+        case OpLog::SPLIT_EDGE:
+        case OpLog::ADD_FACE_VERTEX:
+        case OpLog::MERGE_VERTICES:
+        case OpLog::DELETE_EDGE: {
+            HEdge *edge = reader.readRef(surface->edges);
+            if (!reader.valid)
+                return false;
+            if (op == OpLog::SPLIT_EDGE)
+                opSymmetry ? opSymmetry->splitEdge(surface, edge) : splitEdge(surface, edge);
+            else if (op == OpLog::ADD_FACE_VERTEX)
+                addFaceVertex(surface, edge);
+            else if (op == OpLog::MERGE_VERTICES)
+                mergeVerticesAlongEdge(surface, edge);
+            else
+                deleteEdge(surface, edge);
+            return true;
+        }
+        case OpLog::SPLIT_FACE: {
+            HEdge *e1 = reader.readRef(surface->edges);
+            HEdge *e2 = reader.readRef(surface->edges);
+            if (!reader.valid)
+                return false;
+            opSymmetry ? opSymmetry->splitFace(surface, e1, e2) : splitFace(surface, e1, e2);
+            return true;
+        }
+        case OpLog::EXTRUDE_FACE: {
+            Face *face = reader.readRef(surface->faces);
+            if (!reader.valid)
+                return false;
+            opSymmetry ? opSymmetry->extrudeFace(surface, face) : extrudeFace(surface, face);
+            return true;
+        }
+        case OpLog::MOVE_VERTICES: {
+            uint32_t count = reader.read<uint32_t>();
+            if (count > reader.data.size() - reader.pos)
+                return false;
+            std::vector<std::pair<Vertex *, glm::vec3>> moves(count);
+            for (auto &move : moves) {
+                move.first = reader.readRef(surface->vertices);
+                move.second = reader.read<glm::vec3>();
+            }
+            if (!reader.valid)
+                return false;
+            if (opSymmetry) {
+                opSymmetry->moveVertices(moves);
+            } else {
+                for (auto &move : moves)
+                    move.first->pos += move.second;
+            }
+            return true;
+        }
+        case OpLog::WELD:
+            weldVertices(surface, reader.read<float>());
+            return reader.valid;
+        case OpLog::SMOOTH: {
+            SmoothOptions options;
+            options.weights = (SmoothOptions::Weights)reader.read<uint8_t>();
+            options.iterations = reader.read<int32_t>();
+            options.lambda = reader.read<float>();
+            options.taubin = reader.read<uint8_t>() != 0;
+            options.mu = reader.read<float>();
+            std::unordered_set<Vertex *> selection;
+            uint32_t count = reader.read<uint32_t>();
+            for (uint32_t i = 0; i < count && reader.valid; i++)
+                selection.insert(reader.readRef(surface->vertices));
+            if (!reader.valid)
+                return false;
+            smoothSurface(surface, options, selection);
+            return true;
+        }
+        case OpLog::BUILD_SYMMETRY:
+            symmetry->axis = reader.read<int32_t>();
+            symmetry->tolerance = reader.read<float>();
+            if (!reader.valid)
+                return false;
+            symmetry->build(surface);
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool replayLog(const char *path, Surface *surface, ReplayTiming *timing) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        wprintf(L"Couldn't open log file!\n");
+        return false;
+    }
+    LogReader reader;
+    uint8_t chunk[65536];
+    size_t count;
+    while ((count = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        reader.data.insert(reader.data.end(), chunk, chunk + count);
+    fclose(file);
+
+    char magic[4];
+    for (char &c : magic)
+        c = reader.read<char>();
+    if (!reader.valid || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0
+            || reader.read<uint32_t>() != VERSION) {
+        wprintf(L"Not a log file, or from an incompatible version!\n");
+        return false;
+    }
+
+    Symmetry symmetry;
+    while (reader.pos < reader.data.size()) {
+        OpLog::Op op = (OpLog::Op)reader.read<uint8_t>();
+        AllocationCounter allocations;
+        auto start = std::chrono::steady_clock::now();
+        if (!replayOp(reader, op, surface, &symmetry)) {
+            wprintf(L"Log doesn't match surface at operation %zu!\n", timing->ops.size());
+            return false;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        timing->ops.push_back({op, elapsed.count(), allocations.count(), allocations.bytes()});
+    }
+    return true;
+}
+
+} // namespace
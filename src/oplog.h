@@ -0,0 +1,92 @@
+#pragma once
+#include <common.h>
+
+#include "surface.h"
+#include "smooth.h"
+#include "symmetry.h"
+#include <cstdint>
+#include <cstdio>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include <glm/glm/vec3.hpp>
+
+namespace winged {
+
+// compact binary log of editing operations, to reproduce a session headlessly.
+// elements are referenced by their index and id at the time of the operation. operations are
+// deterministic, so replaying the log from an empty surface assigns the same ids again
+class OpLog {
+public:
+    enum Op : uint8_t {
+        MAKE_CUBE,
+        SPLIT_EDGE,
+        SPLIT_FACE,
+        ADD_FACE_VERTEX,
+        MERGE_VERTICES,
+        DELETE_EDGE,
+        EXTRUDE_FACE,
+        MOVE_VERTICES,
+        WELD,
+        SMOOTH,
+        BUILD_SYMMETRY,
+        NUM_OPS
+    };
+    static const wchar_t * const OP_NAMES[NUM_OPS];
+
+    ~OpLog();
+    bool record(const char *path); // start writing to a new file
+    void stop();
+    bool recording() const { return file != nullptr; }
+
+    // perform the operation, then log it if it succeeded (or changed the surface anyway). pass
+    // symmetry to use its mirrored version of the operation
+    void makeCube(Surface *surface);
+    bool splitEdge(Surface *surface, HEdge *edge, Symmetry *symmetry = nullptr);
+    bool splitFace(Surface *surface, HEdge *e1, HEdge *e2, Symmetry *symmetry = nullptr);
+    bool addFaceVertex(Surface *surface, HEdge *edge);
+    bool mergeVerticesAlongEdge(Surface *surface, HEdge *edge);
+    bool deleteEdge(Surface *surface, HEdge *edge);
+    bool extrudeFace(Surface *surface, Face *face, Symmetry *symmetry = nullptr);
+    void moveVertices(const std::vector<std::pair<Vertex *, glm::vec3>> &moves,
+        Symmetry *symmetry = nullptr);
+    int weldVertices(Surface *surface, float tolerance);
+    void smoothSurface(Surface *surface, const SmoothOptions &options,
+        const std::unordered_set<Vertex *> &selection);
+    bool buildSymmetry(Symmetry *symmetry, Surface *surface);
+
+private:
+    FILE *file = nullptr;
+    std::vector<uint8_t> buffer; // current operation
+
+    template<typename T>
+    void write(T value) {
+        if (!file)
+            return;
+        const uint8_t *bytes = (const uint8_t *)&value;
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+    }
+    template<typename T>
+    void writeRef(const T *element) {
+        write((uint32_t)element->index);
+        write(element->id);
+    }
+    void begin(Op op);
+    void flush();
+    bool finish(bool ok, const Surface *surface, uint32_t startId);
+};
+
+struct ReplayTiming {
+    struct Entry {
+        OpLog::Op op;
+        double seconds;
+        size_t allocations, allocatedBytes; // on the replaying thread
+    };
+    std::vector<Entry> ops; // every operation in order
+};
+
+// apply a recorded log to an empty surface. fails if the log doesn't match the surface (it was
+// recorded from a different starting point, or by an incompatible version)
+bool replayLog(const char *path, Surface *surface, ReplayTiming *timing);
+
+} // namespace
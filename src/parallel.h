@@ -0,0 +1,35 @@
+#pragma once
+#include <common.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace winged {
+
+// set on threads which are already running alongside many others (eg. one per file), so loops
+// inside them don't spawn more threads than there are cores
+inline thread_local bool parallelSerial = false;
+
+// split [0, count) into contiguous chunks and call func(begin, end) for each chunk on its own
+// thread. small ranges run on the calling thread.
+template<typename Func>
+void parallelFor(size_t count, Func func, size_t minChunk = 4096) {
+    size_t numThreads = parallelSerial ? 1 : std::max(1u, std::thread::hardware_concurrency());
+    numThreads = std::min(numThreads, (count + minChunk - 1) / minChunk);
+    if (numThreads <= 1) {
+        if (count)
+            func((size_t)0, count);
+        return;
+    }
+    size_t chunk = (count + numThreads - 1) / numThreads;
+    std::vector<std::thread> threads;
+    for (size_t begin = chunk; begin < count; begin += chunk)
+        threads.emplace_back(func, begin, std::min(begin + chunk, count));
+    func((size_t)0, std::min(chunk, count));
+    for (auto &thread : threads)
+        thread.join();
+}
+
+} // namespace
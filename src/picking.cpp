@@ -1,17 +1,8 @@
 #include "picking.h"
-#include <windows.h> // must include before GLU
-#include <gl/GLU.h>
+#include <glm/glm/common.hpp>
 
 namespace winged {
 
-Picker::Picker() {
-    tess = gluNewTess();
-}
-
-Picker::~Picker() {
-    gluDeleteTess(tess);
-}
-
 Picker::Result Picker::pickSurfaceElement(Surface *surface, Surface::ElementType types,
         glm::vec2 cursor, glm::vec2 windowDim, const glm::mat4 &project) {
     // normalized device coords
@@ -6,8 +6,6 @@
 #include <glm/glm/vec3.hpp>
 #include <glm/glm/mat4x4.hpp>
 
-class GLUtesselator; // gl/GLU.h
-
 namespace winged {
 
 class Picker {
@@ -22,14 +20,8 @@ public:
         glm::vec3 point;
     };
 
-    Picker();
-    ~Picker();
-
     Result pickSurfaceElement(Surface *surface, Surface::ElementType types,
         glm::vec2 cursor, glm::vec2 windowDim, const glm::mat4 &project);
-
-private:
-    GLUtesselator *tess;
 };
 
 } // namespace
@@ -0,0 +1,167 @@
+#include "polygon.h"
+#include "predicates.h"
+#include <utility>
+#include <glm/glm/common.hpp>
+#include <glm/glm/vec3.hpp>
+
+namespace winged {
+
+void projectFace(Face *face, std::vector<glm::dvec2> *points) {
+    // Newell's method, only used to pick the plane
+    glm::dvec3 normal(0);
+    for (ITER_FACE_EDGES(face, edge)) {
+        glm::dvec3 sum = glm::dvec3(edge->vert->pos) + glm::dvec3(edge->next->vert->pos);
+        glm::dvec3 diff = glm::dvec3(edge->vert->pos) - glm::dvec3(edge->next->vert->pos);
+        normal += glm::dvec3(diff.y * sum.z, diff.z * sum.x, diff.x * sum.y);
+    }
+    glm::dvec3 absNormal = glm::abs(normal);
+    int axis = absNormal.x > absNormal.y ? (absNormal.x > absNormal.z ? 0 : 2)
+        : (absNormal.y > absNormal.z ? 1 : 2);
+    // (u, v, axis) is right handed, so counter-clockwise around the normal stays that way
+    int u = (axis + 1) % 3, v = (axis + 2) % 3;
+    if (normal[axis] < 0)
+        std::swap(u, v);
+    points->clear();
+    for (ITER_FACE_EDGES(face, edge))
+        points->push_back(glm::dvec2(edge->vert->pos[u], edge->vert->pos[v]));
+}
+
+void triangulatePolygon(const std::vector<glm::dvec2> &points, std::vector<int> *triangles) {
+    int n = (int)points.size();
+    if (n < 3)
+        return;
+    std::vector<int> prev(n), next(n);
+    std::vector<double> turn(n); // orient2d at each corner, > 0 if convex
+    int nonConvex = 0;
+    for (int i = 0; i < n; i++) {
+        prev[i] = (i + n - 1) % n;
+        next[i] = (i + 1) % n;
+    }
+    auto updateTurn = [&](int i, bool counted) {
+        if (counted && turn[i] <= 0)
+            nonConvex--;
+        turn[i] = orient2d(points[prev[i]], points[i], points[next[i]]);
+        if (turn[i] <= 0)
+            nonConvex++;
+    };
+    for (int i = 0; i < n; i++)
+        updateTurn(i, false);
+
+    auto isEar = [&](int i) {
+        if (turn[i] <= 0)
+            return false;
+        if (nonConvex == 0)
+            return true;
+        glm::dvec2 a = points[prev[i]], b = points[i], c = points[next[i]];
+        for (int j = next[next[i]]; j != prev[i]; j = next[j]) {
+            // a convex corner can only be inside the ear if a reflex one is too
+            if (turn[j] > 0)
+                continue;
+            glm::dvec2 p = points[j];
+            if (p == a || p == b || p == c)
+                continue; // polygon touches itself here
+            if (orient2d(a, b, p) >= 0 && orient2d(b, c, p) >= 0 && orient2d(c, a, p) >= 0)
+                return false;
+        }
+        return true;
+    };
+
+    int remaining = n, i = 0, tried = 0;
+    while (remaining > 3) {
+        if (!isEar(i)) {
+            if (++tried < remaining) {
+                i = next[i];
+                continue;
+            }
+            // no ears left, which only happens with self-intersection
+            int best = i;
+            for (int j = next[i]; j != i; j = next[j]) {
+                if (turn[j] > turn[best])
+                    best = j;
+            }
+            i = best;
+        }
+        int p = prev[i], q = next[i];
+        triangles->insert(triangles->end(), {p, i, q});
+        next[p] = q;
+        prev[q] = p;
+        if (turn[i] <= 0)
+            nonConvex--;
+        remaining--;
+        updateTurn(p, true);
+        updateTurn(q, true);
+        i = q;
+        tried = 0;
+    }
+    triangles->insert(triangles->end(), {prev[i], i, next[i]});
+}
+
+FaceShape classifyPolygon(const std::vector<glm::dvec2> &points) {
+    int n = (int)points.size();
+    bool left = false, right = false;
+    for (int i = 0; i < n; i++) {
+        double turn = orient2d(points[(i + n - 1) % n], points[i], points[(i + 1) % n]);
+        left = left || turn > 0;
+        right = right || turn < 0;
+    }
+    if (!left && !right)
+        return FACE_DEGENERATE;
+    if (right)
+        return FACE_CONCAVE;
+    // only left turns, but a star polygon winds around more than once. going around a convex
+    // polygon, the x direction of the edges changes sign twice. comparisons are exact
+    int firstSign = 0, lastSign = 0, changes = 0;
+    for (int i = 0; i < n; i++) {
+        double x = points[i].x, nextX = points[(i + 1) % n].x;
+        int sign = (nextX > x) - (nextX < x);
+        if (!sign)
+            continue;
+        if (!firstSign)
+            firstSign = sign;
+        else if (sign != lastSign)
+            changes++;
+        lastSign = sign;
+    }
+    if (lastSign != firstSign)
+        changes++;
+    return changes > 2 ? FACE_CONCAVE : FACE_CONVEX;
+}
+
+FaceShape classifyFace(Face *face) {
+    std::vector<glm::dvec2> points;
+    projectFace(face, &points);
+    return classifyPolygon(points);
+}
+
+static bool collinear(glm::dvec3 a, glm::dvec3 b, glm::dvec3 c) {
+    // in 3D only if all three projections onto the axis planes are
+    return orient2d(glm::dvec2(a.x, a.y), glm::dvec2(b.x, b.y), glm::dvec2(c.x, c.y)) == 0
+        && orient2d(glm::dvec2(a.y, a.z), glm::dvec2(b.y, b.z), glm::dvec2(c.y, c.z)) == 0
+        && orient2d(glm::dvec2(a.z, a.x), glm::dvec2(b.z, b.x), glm::dvec2(c.z, c.x)) == 0;
+}
+
+bool isPlanar(Face *face) {
+    // find three vertices which aren't collinear to define the plane
+    HEdge *edgeA = face->edge, *edgeB = nullptr, *edgeC = nullptr;
+    glm::dvec3 a = edgeA->vert->pos;
+    for (HEdge *edge = edgeA->next; edge != edgeA; edge = edge->next) {
+        glm::dvec3 pos = edge->vert->pos;
+        if (!edgeB) {
+            if (pos != a)
+                edgeB = edge;
+        } else if (!collinear(a, edgeB->vert->pos, pos)) {
+            edgeC = edge;
+            break;
+        }
+    }
+    if (!edgeC)
+        return true;
+    glm::dvec3 b = edgeB->vert->pos, c = edgeC->vert->pos;
+    for (ITER_FACE_EDGES(face, edge)) {
+        if (orient3d(a, b, c, edge->vert->pos) != 0)
+            return false;
+    }
+    return true;
+}
+
+} // namespace
@@ -0,0 +1,31 @@
+#pragma once
+#include <common.h>
+
+#include "surface.h"
+#include <vector>
+#include <glm/glm/vec2.hpp>
+
+namespace winged {
+
+// all built on the exact predicates, so they don't depend on rounding
+
+enum FaceShape {
+    FACE_CONVEX, // no reflex corners (straight ones are allowed) and winds around once
+    FACE_CONCAVE, // including self-intersecting
+    FACE_DEGENERATE // zero area, all vertices are on one line
+};
+
+// vertices in order starting at face->edge, projected onto the axis plane most parallel to the
+// face so that they stay counter-clockwise. dropping a coordinate is exact
+void projectFace(Face *face, std::vector<glm::dvec2> *points);
+// ear clipping. appends index triples (previous, ear, next) in the order the ears are cut off,
+// the last one is what remains. O(n) for convex polygons, O(n^2) worst case.
+// always gives n - 2 triangles: if a self-intersecting polygon has no ear left, the least bad
+// corner is cut off anyway
+void triangulatePolygon(const std::vector<glm::dvec2> &points, std::vector<int> *triangles);
+FaceShape classifyPolygon(const std::vector<glm::dvec2> &points);
+FaceShape classifyFace(Face *face);
+// every vertex is exactly on one plane. true if all vertices are collinear. O(n)
+bool isPlanar(Face *face);
+
+} // namespace
@@ -0,0 +1,318 @@
+#include "predicates.h"
+#include <cmath>
+#include <vector>
+
+namespace winged {
+
+// expansions are sums of non-overlapping doubles, ordered from smallest to largest magnitude.
+// the largest component has the sign of the whole sum
+namespace {
+
+const double EPSILON = 1.1102230246251565e-16; // 2^-53
+const double SPLITTER = 134217729.0; // 2^27 + 1
+const double ORIENT2D_BOUND = (3 + 16 * EPSILON) * EPSILON;
+const double ORIENT3D_BOUND = (7 + 56 * EPSILON) * EPSILON;
+const double INCIRCLE_BOUND = (10 + 96 * EPSILON) * EPSILON;
+
+// x + y == a + b exactly
+inline void twoSum(double a, double b, double &x, double &y) {
+    x = a + b;
+    double bVirtual = x - a;
+    double aVirtual = x - bVirtual;
+    y = (a - aVirtual) + (b - bVirtual);
+}
+
+// requires |a| >= |b|
+inline void fastTwoSum(double a, double b, double &x, double &y) {
+    x = a + b;
+    y = b - (x - a);
+}
+
+inline void twoDiff(double a, double b, double &x, double &y) {
+    x = a - b;
+    double bVirtual = a - x;
+    double aVirtual = x + bVirtual;
+    y = (a - aVirtual) + (bVirtual - b);
+}
+
+inline void split(double a, double &hi, double &lo) {
+    double c = SPLITTER * a;
+    hi = c - (c - a);
+    lo = a - hi;
+}
+
+// x + y == a * b exactly
+inline void twoProduct(double a, double b, double &x, double &y) {
+    x = a * b;
+    double aHi, aLo, bHi, bLo;
+    split(a, aHi, aLo);
+    split(b, bHi, bLo);
+    double err = x - aHi * bHi - aLo * bHi - aHi * bLo;
+    y = aLo * bLo - err;
+}
+
+// h = e + f, zero components removed. h has room for elen + flen and is not e or f
+int sumExpansions(const double *e, int elen, const double *f, int flen, double *h) {
+    int ei = 0, fi = 0, hi = 0;
+    double eNow = e[0], fNow = f[0], q, qNew, hh;
+    auto nextE = [&]() { eNow = ++ei < elen ? e[ei] : 0; };
+    auto nextF = [&]() { fNow = ++fi < flen ? f[fi] : 0; };
+    // merge by magnitude
+    if ((fNow > eNow) == (fNow > -eNow)) {
+        q = eNow;
+        nextE();
+    } else {
+        q = fNow;
+        nextF();
+    }
+    if (ei < elen && fi < flen) {
+        if ((fNow > eNow) == (fNow > -eNow)) {
+            fastTwoSum(eNow, q, qNew, hh);
+            nextE();
+        } else {
+            fastTwoSum(fNow, q, qNew, hh);
+            nextF();
+        }
+        q = qNew;
+        if (hh != 0)
+            h[hi++] = hh;
+        while (ei < elen && fi < flen) {
+            if ((fNow > eNow) == (fNow > -eNow)) {
+                twoSum(q, eNow, qNew, hh);
+                nextE();
+            } else {
+                twoSum(q, fNow, qNew, hh);
+                nextF();
+            }
+            q = qNew;
+            if (hh != 0)
+                h[hi++] = hh;
+        }
+    }
+    for (; ei < elen; nextE()) {
+        twoSum(q, eNow, qNew, hh);
+        q = qNew;
+        if (hh != 0)
+            h[hi++] = hh;
+    }
+    for (; fi < flen; nextF()) {
+        twoSum(q, fNow, qNew, hh);
+        q = qNew;
+        if (hh != 0)
+            h[hi++] = hh;
+    }
+    if (q != 0 || hi == 0)
+        h[hi++] = q;
+    return hi;
+}
+
+// h = e * b, zero components removed. h has room for 2 * elen
+int scaleExpansion(const double *e, int elen, double b, double *h) {
+    double q, hh, p1, p0, sum;
+    int hi = 0;
+    twoProduct(e[0], b, q, hh);
+    if (hh != 0)
+        h[hi++] = hh;
+    for (int i = 1; i < elen; i++) {
+        twoProduct(e[i], b, p1, p0);
+        twoSum(q, p0, sum, hh);
+        if (hh != 0)
+            h[hi++] = hh;
+        fastTwoSum(p1, sum, q, hh);
+        if (hh != 0)
+            h[hi++] = hh;
+    }
+    if (q != 0 || hi == 0)
+        h[hi++] = q;
+    return hi;
+}
+
+// h = a * b as an expansion of one or two components
+int product(double a, double b, double *h) {
+    double x, y;
+    twoProduct(a, b, x, y);
+    if (y == 0) {
+        h[0] = x;
+        return 1;
+    }
+    h[0] = y;
+    h[1] = x;
+    return 2;
+}
+
+double estimate(const double *e, int elen) {
+    double sum = 0;
+    for (int i = 0; i < elen; i++)
+        sum += e[i];
+    return sum;
+}
+
+// arbitrary length, for the rare cases where differences of the inputs aren't exact
+using Expansion = std::vector<double>;
+
+Expansion difference(double a, double b) {
+    double x, y;
+    twoDiff(a, b, x, y);
+    return y == 0 ? Expansion {x} : Expansion {y, x};
+}
+
+Expansion operator+(const Expansion &e, const Expansion &f) {
+    Expansion h(e.size() + f.size());
+    h.resize(sumExpansions(e.data(), (int)e.size(), f.data(), (int)f.size(), h.data()));
+    return h;
+}
+
+Expansion operator-(const Expansion &e) {
+    Expansion h = e;
+    for (double &c : h)
+        c = -c;
+    return h;
+}
+
+Expansion operator-(const Expansion &e, const Expansion &f) {
+    return e + -f;
+}
+
+Expansion operator*(const Expansion &e, const Expansion &f) {
+    Expansion h, scaled(e.size() * 2);
+    for (double c : f) {
+        scaled.resize(e.size() * 2);
+        scaled.resize(scaleExpansion(e.data(), (int)e.size(), c, scaled.data()));
+        h = h.empty() ? scaled : h + scaled;
+    }
+    return h;
+}
+
+double estimate(const Expansion &e) {
+    return estimate(e.data(), (int)e.size());
+}
+
+double orient2dExact(glm::dvec2 a, glm::dvec2 b, glm::dvec2 c) {
+    // expanded into products of the coordinates, which are exact as expansions
+    double terms[6][2], sums[3][4], half[8], total[12];
+    int len[6];
+    len[0] = product(a.x, b.y, terms[0]);
+    len[1] = product(-a.x, c.y, terms[1]);
+    len[2] = product(-a.y, b.x, terms[2]);
+    len[3] = product(a.y, c.x, terms[3]);
+    len[4] = product(b.x, c.y, terms[4]);
+    len[5] = product(-b.y, c.x, terms[5]);
+    int sumLen[3];
+    for (int i = 0; i < 3; i++)
+        sumLen[i] = sumExpansions(terms[i * 2], len[i * 2], terms[i * 2 + 1], len[i * 2 + 1],
+            sums[i]);
+    int halfLen = sumExpansions(sums[0], sumLen[0], sums[1], sumLen[1], half);
+    int totalLen = sumExpansions(half, halfLen, sums[2], sumLen[2], total);
+    return estimate(total, totalLen);
+}
+
+// determinant of the rows a - d, b - d, c - d (opposite sign from orient3d)
+double orient3dExact(glm::dvec3 a, glm::dvec3 b, glm::dvec3 c, glm::dvec3 d) {
+    double ad[3], bd[3], cd[3], tail[9];
+    for (int i = 0; i < 3; i++) {
+        twoDiff(a[i], d[i], ad[i], tail[i * 3]);
+        twoDiff(b[i], d[i], bd[i], tail[i * 3 + 1]);
+        twoDiff(c[i], d[i], cd[i], tail[i * 3 + 2]);
+    }
+    bool exactDiffs = true;
+    for (double t : tail)
+        exactDiffs = exactDiffs && t == 0;
+
+    if (exactDiffs) {
+        // common case, eg. for coordinates which are all floats. fixed size, no allocation
+        double p[2], q[2], minor[3][4], scaled[3][8], partial[16], total[24];
+        int pLen, qLen, minorLen[3], scaledLen[3];
+        const double *rows[3] = {ad, bd, cd};
+        for (int i = 0; i < 3; i++) {
+            const double *u = rows[(i + 1) % 3], *v = rows[(i + 2) % 3];
+            pLen = product(u[0], v[1], p);
+            qLen = product(-v[0], u[1], q);
+            minorLen[i] = sumExpansions(p, pLen, q, qLen, minor[i]);
+            scaledLen[i] = scaleExpansion(minor[i], minorLen[i], rows[i][2], scaled[i]);
+        }
+        int partialLen = sumExpansions(scaled[0], scaledLen[0], scaled[1], scaledLen[1], partial);
+        int totalLen = sumExpansions(partial, partialLen, scaled[2], scaledLen[2], total);
+        return estimate(total, totalLen);
+    }
+
+    Expansion e[3][3];
+    for (int i = 0; i < 3; i++) {
+        e[0][i] = difference(a[i], d[i]);
+        e[1][i] = difference(b[i], d[i]);
+        e[2][i] = difference(c[i], d[i]);
+    }
+    Expansion det;
+    for (int i = 0; i < 3; i++) {
+        const Expansion *u = e[(i + 1) % 3], *v = e[(i + 2) % 3];
+        Expansion term = (u[0] * v[1] - v[0] * u[1]) * e[i][2];
+        det = det.empty() ? term : det + term;
+    }
+    return estimate(det);
+}
+
+double incircleExact(glm::dvec2 a, glm::dvec2 b, glm::dvec2 c, glm::dvec2 d) {
+    Expansion e[3][2];
+    glm::dvec2 points[3] = {a, b, c};
+    for (int i = 0; i < 3; i++) {
+        e[i][0] = difference(points[i].x, d.x);
+        e[i][1] = difference(points[i].y, d.y);
+    }
+    Expansion det;
+    for (int i = 0; i < 3; i++) {
+        const Expansion *u = e[(i + 1) % 3], *v = e[(i + 2) % 3];
+        Expansion lift = e[i][0] * e[i][0] + e[i][1] * e[i][1];
+        Expansion term = (u[0] * v[1] - v[0] * u[1]) * lift;
+        det = det.empty() ? term : det + term;
+    }
+    return estimate(det);
+}
+
+} // namespace
+
+double orient2d(glm::dvec2 a, glm::dvec2 b, glm::dvec2 c) {
+    double left = (a.x - c.x) * (b.y - c.y);
+    double right = (a.y - c.y) * (b.x - c.x);
+    double det = left - right;
+    // if the terms have different signs there's no cancellation and this always passes.
+    // a single test is cheaper than branching on the signs, which is unpredictable
+    double bound = ORIENT2D_BOUND * (std::abs(left) + std::abs(right));
+    if (std::abs(det) >= bound)
+        return det;
+    return orient2dExact(a, b, c);
+}
+
+double orient3d(glm::dvec3 a, glm::dvec3 b, glm::dvec3 c, glm::dvec3 d) {
+    glm::dvec3 ad = a - d, bd = b - d, cd = c - d;
+    double bdxcdy = bd.x * cd.y, cdxbdy = cd.x * bd.y;
+    double cdxady = cd.x * ad.y, adxcdy = ad.x * cd.y;
+    double adxbdy = ad.x * bd.y, bdxady = bd.x * ad.y;
+    double det = ad.z * (bdxcdy - cdxbdy) + bd.z * (cdxady - adxcdy) + cd.z * (adxbdy - bdxady);
+    double permanent = (std::abs(bdxcdy) + std::abs(cdxbdy)) * std::abs(ad.z)
+        + (std::abs(cdxady) + std::abs(adxcdy)) * std::abs(bd.z)
+        + (std::abs(adxbdy) + std::abs(bdxady)) * std::abs(cd.z);
+    double bound = ORIENT3D_BOUND * permanent;
+    if (std::abs(det) > bound)
+        return -det;
+    return -orient3dExact(a, b, c, d);
+}
+
+double incircle(glm::dvec2 a, glm::dvec2 b, glm::dvec2 c, glm::dvec2 d) {
+    glm::dvec2 ad = a - d, bd = b - d, cd = c - d;
+    double bdxcdy = bd.x * cd.y, cdxbdy = cd.x * bd.y;
+    double cdxady = cd.x * ad.y, adxcdy = ad.x * cd.y;
+    double adxbdy = ad.x * bd.y, bdxady = bd.x * ad.y;
+    double aLift = ad.x * ad.x + ad.y * ad.y;
+    double bLift = bd.x * bd.x + bd.y * bd.y;
+    double cLift = cd.x * cd.x + cd.y * cd.y;
+    double det = aLift * (bdxcdy - cdxbdy) + bLift * (cdxady - adxcdy)
+        + cLift * (adxbdy - bdxady);
+    double permanent = (std::abs(bdxcdy) + std::abs(cdxbdy)) * aLift
+        + (std::abs(cdxady) + std::abs(adxcdy)) * bLift
+        + (std::abs(adxbdy) + std::abs(bdxady)) * cLift;
+    double bound = INCIRCLE_BOUND * permanent;
+    if (std::abs(det) > bound)
+        return det;
+    return incircleExact(a, b, c, d);
+}
+
+} // namespace
@@ -0,0 +1,26 @@
+#pragma once
+#include <common.h>
+
+#include <glm/glm/vec2.hpp>
+#include <glm/glm/vec3.hpp>
+
+namespace winged {
+
+// geometric predicates with exactly correct signs, after Shewchuk's "Adaptive Precision
+// Floating-Point Arithmetic and Fast Robust Geometric Predicates". a plain floating point
+// evaluation with an error bound decides almost every case; only nearly degenerate inputs fall
+// back to exact arithmetic. magnitudes are approximate, only the sign is exact.
+// needs strict IEEE double arithmetic (no x87 extended precision or fused multiply-add
+// contraction), which is the default for x64 builds
+
+// > 0 if a, b, c are counter-clockwise, < 0 if clockwise, 0 if collinear.
+// about twice the area of the triangle
+double orient2d(glm::dvec2 a, glm::dvec2 b, glm::dvec2 c);
+// > 0 if d is above the plane of a, b, c (on the side the counter-clockwise normal points to),
+// < 0 if below, 0 if coplanar. about six times the volume of the tetrahedron
+double orient3d(glm::dvec3 a, glm::dvec3 b, glm::dvec3 c, glm::dvec3 d);
+// > 0 if d is inside the circle through a, b, c, which must be counter-clockwise, < 0 if
+// outside, 0 if on the circle
+double incircle(glm::dvec2 a, glm::dvec2 b, glm::dvec2 c, glm::dvec2 d);
+
+} // namespace
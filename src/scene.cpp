@@ -0,0 +1,214 @@
+#include "scene.h"
+#include <algorithm>
+#include <utility>
+#include <glm/glm/geometric.hpp>
+
+namespace winged {
+
+const Bounds & Mesh::bounds() {
+    if (dirty) {
+        cachedBounds = Bounds();
+        for (auto &vert : surface.vertices)
+            cachedBounds.extend(vert->pos);
+        dirty = false;
+        version++;
+    }
+    return cachedBounds;
+}
+
+Bounds transformBounds(const Bounds &box, const glm::mat4 &transform) {
+    if (box.empty())
+        return box;
+    // Arvo's method: transform the center, and extents by the absolute value of the matrix
+    glm::vec3 center = box.center(), extent = (box.max - box.min) * 0.5f;
+    Bounds result;
+    for (int row = 0; row < 3; row++) {
+        float c = transform[3][row], e = 0;
+        for (int col = 0; col < 3; col++) {
+            c += transform[col][row] * center[col];
+            e += glm::abs(transform[col][row]) * extent[col];
+        }
+        result.min[row] = c - e;
+        result.max[row] = c + e;
+    }
+    return result;
+}
+
+SceneObject * Scene::add(std::shared_ptr<Mesh> mesh, const glm::mat4 &transform) {
+    SceneObject *object = objects.emplace_back(new SceneObject).get();
+    object->mesh = std::move(mesh);
+    object->transform = transform;
+    object->index = objects.size() - 1;
+    objectBounds.emplace_back();
+    dirtyObjects.push_back(object);
+    Mesh *m = object->mesh.get();
+    auto found = meshes.find(m);
+    if (found == meshes.end())
+        found = meshes.insert({m, {{}, m->version}}).first;
+    found->second.objects.push_back(object);
+    rebuildBVH = true;
+    return object;
+}
+
+static void removeObject(std::vector<SceneObject *> *list, SceneObject *object) {
+    auto found = std::find(list->begin(), list->end(), object);
+    if (found != list->end()) {
+        *found = list->back();
+        list->pop_back();
+    }
+}
+
+bool Scene::remove(SceneObject *object) {
+    size_t i = object->index;
+    if (i >= objects.size() || objects[i].get() != object)
+        return false;
+    if (object->transformDirty)
+        removeObject(&dirtyObjects, object);
+    auto found = meshes.find(object->mesh.get());
+    removeObject(&found->second.objects, object);
+    if (found->second.objects.empty())
+        meshes.erase(found);
+    objects[i] = std::move(objects.back());
+    objects[i]->index = i;
+    objects.pop_back();
+    objectBounds[i] = objectBounds.back();
+    objectBounds.pop_back();
+    rebuildBVH = true;
+    return true;
+}
+
+void Scene::setTransform(SceneObject *object, const glm::mat4 &transform) {
+    object->transform = transform;
+    if (!object->transformDirty) {
+        object->transformDirty = true;
+        dirtyObjects.push_back(object);
+    }
+}
+
+void Scene::update() {
+    std::vector<int> changed;
+    for (auto &pair : meshes) {
+        Mesh *mesh = pair.first;
+        mesh->bounds(); // shared meshes are only recomputed once
+        if (pair.second.version == mesh->version)
+            continue;
+        pair.second.version = mesh->version;
+        for (SceneObject *object : pair.second.objects) {
+            if (!object->transformDirty) // otherwise done below
+                changed.push_back((int)object->index);
+        }
+    }
+    for (SceneObject *object : dirtyObjects) {
+        object->transformDirty = false;
+        changed.push_back((int)object->index);
+    }
+    dirtyObjects.clear();
+    if (changed.empty() && !rebuildBVH)
+        return;
+    for (int i : changed) {
+        SceneObject *object = objects[i].get();
+        object->worldBounds = transformBounds(object->mesh->cachedBounds, object->transform);
+        objectBounds[i] = object->worldBounds;
+    }
+    if (rebuildBVH)
+        bvh.build(objectBounds);
+    else
+        bvh.refit(objectBounds, changed);
+    rebuildBVH = false;
+}
+
+// false if box is entirely outside any of the planes
+static bool insidePlanes(const Bounds &box, const glm::vec4 (&planes)[6]) {
+    if (box.empty())
+        return false;
+    for (auto &plane : planes) {
+        // corner furthest along the plane normal
+        glm::vec3 corner(plane.x >= 0 ? box.max.x : box.min.x,
+            plane.y >= 0 ? box.max.y : box.min.y, plane.z >= 0 ? box.max.z : box.min.z);
+        if (plane.x * corner.x + plane.y * corner.y + plane.z * corner.z + plane.w < 0)
+            return false;
+    }
+    return true;
+}
+
+void Scene::cull(const glm::mat4 &viewProj, std::vector<SceneObject *> *visible) const {
+    // https://www.gamedevs.org/uploads/fast-extraction-viewing-frustum-planes-from-world-view-projection-matrix.pdf
+    glm::vec4 rows[4];
+    for (int r = 0; r < 4; r++)
+        rows[r] = glm::vec4(viewProj[0][r], viewProj[1][r], viewProj[2][r], viewProj[3][r]);
+    glm::vec4 planes[6];
+    for (int i = 0; i < 3; i++) {
+        planes[i * 2] = rows[3] + rows[i];
+        planes[i * 2 + 1] = rows[3] - rows[i];
+    }
+
+    visible->clear();
+    bvh.traverse([&](const Bounds &box) {
+        return insidePlanes(box, planes);
+    }, [&](int i) {
+        if (insidePlanes(objects[i]->worldBounds, planes))
+            visible->push_back(objects[i].get());
+    });
+}
+
+// whether box projected to the screen could cover the cursor. depth is the nearest
+// normalized depth, or -1 if part of the box is behind the camera
+static bool coversCursor(const Bounds &box, const glm::mat4 &viewProj, glm::vec2 cursor,
+        glm::vec2 margin, float *depth) {
+    if (box.empty())
+        return false;
+    Bounds screen;
+    for (int i = 0; i < 8; i++) {
+        glm::vec4 corner(i & 1 ? box.max.x : box.min.x, i & 2 ? box.max.y : box.min.y,
+            i & 4 ? box.max.z : box.min.z, 1);
+        glm::vec4 clip = viewProj * corner;
+        if (clip.w <= 0) {
+            *depth = -1; // projection is unbounded, can't reject
+            return true;
+        }
+        screen.extend(glm::vec3(clip) / clip.w);
+    }
+    *depth = screen.min.z;
+    return !(cursor.x < screen.min.x - margin.x || cursor.x > screen.max.x + margin.x
+        || cursor.y < screen.min.y - margin.y || cursor.y > screen.max.y + margin.y
+        || screen.max.z < -1 || screen.min.z > 1);
+}
+
+void Scene::pickCandidates(const glm::mat4 &viewProj, glm::vec2 cursor, glm::vec2 margin,
+        std::vector<SceneObject *> *candidates) const {
+    std::vector<std::pair<float, SceneObject *>> sorted;
+    float depth;
+    bvh.traverse([&](const Bounds &box) {
+        return coversCursor(box, viewProj, cursor, margin, &depth);
+    }, [&](int i) {
+        if (coversCursor(objects[i]->worldBounds, viewProj, cursor, margin, &depth))
+            sorted.push_back({depth, objects[i].get()});
+    });
+    std::sort(sorted.begin(), sorted.end(),
+        [](const std::pair<float, SceneObject *> &a, const std::pair<float, SceneObject *> &b) {
+            return a.first < b.first;
+        });
+    candidates->clear();
+    for (auto &pair : sorted)
+        candidates->push_back(pair.second);
+}
+
+void Scene::raycast(glm::vec3 origin, glm::vec3 dir, float maxT,
+        std::vector<SceneObject *> *hits) const {
+    std::vector<std::pair<float, SceneObject *>> sorted;
+    glm::vec3 invDir = 1.0f / dir;
+    bvh.raycast(origin, dir, maxT, [&](int i) {
+        float t = objects[i]->worldBounds.intersectRay(origin, invDir, maxT);
+        if (t >= 0)
+            sorted.push_back({t, objects[i].get()});
+    });
+    std::sort(sorted.begin(), sorted.end(),
+        [](const std::pair<float, SceneObject *> &a, const std::pair<float, SceneObject *> &b) {
+            return a.first < b.first;
+        });
+    hits->clear();
+    for (auto &pair : sorted)
+        hits->push_back(pair.second);
+}
+
+} // namespace
@@ -0,0 +1,79 @@
+#pragma once
+#include <common.h>
+
+#include "surface.h"
+#include "bvh.h"
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm/vec2.hpp>
+#include <glm/glm/vec3.hpp>
+#include <glm/glm/mat4x4.hpp>
+
+namespace winged {
+
+// surface which may be shared by many scene objects (instances)
+struct Mesh {
+    Surface surface;
+
+    void markDirty() { dirty = true; } // call after changing the surface
+    const Bounds & bounds(); // in object space. recomputed if dirty, O(n)
+
+private:
+    Bounds cachedBounds;
+    bool dirty = true;
+    uint32_t version = 0; // incremented when bounds change, so instances can notice
+    friend class Scene;
+};
+
+struct SceneObject {
+    std::shared_ptr<Mesh> mesh;
+    glm::mat4 transform = glm::mat4(1); // object to world, change with Scene::setTransform()
+    Bounds worldBounds; // as of the last Scene::update()
+    size_t index; // position in Scene::objects
+
+private:
+    bool transformDirty = true; // in Scene::dirtyObjects
+    friend class Scene;
+};
+
+// objects are culled and picked through a BVH over their bounds, so only visible and edited
+// objects cost anything. call update() after changes, before querying
+class Scene {
+public:
+    std::vector<std::unique_ptr<SceneObject>> objects;
+
+    SceneObject * add(std::shared_ptr<Mesh> mesh, const glm::mat4 &transform = glm::mat4(1));
+    bool remove(SceneObject *object); // O(1), changes the order of objects
+    void setTransform(SceneObject *object, const glm::mat4 &transform);
+
+    // recompute bounds of dirty meshes and objects. O(meshes) checks, plus O(n) for each
+    // changed mesh and O(log objects) for each object that moved or has a changed mesh
+    void update();
+
+    // objects at least partially inside the view volume of viewProj (projection * view)
+    void cull(const glm::mat4 &viewProj, std::vector<SceneObject *> *visible) const;
+    // objects which could contain an element drawn at the cursor. bounds are projected to the
+    // screen and expanded by margin (both in normalized device coordinates). nearest first
+    void pickCandidates(const glm::mat4 &viewProj, glm::vec2 cursor, glm::vec2 margin,
+        std::vector<SceneObject *> *candidates) const;
+    // objects whose bounds are hit by the ray within maxT, nearest first
+    void raycast(glm::vec3 origin, glm::vec3 dir, float maxT,
+        std::vector<SceneObject *> *hits) const;
+
+private:
+    struct MeshInstances {
+        std::vector<SceneObject *> objects;
+        uint32_t version; // of the mesh as of the last update()
+    };
+    std::unordered_map<Mesh *, MeshInstances> meshes;
+    std::vector<SceneObject *> dirtyObjects; // transform changed or newly added
+    BVH bvh; // over world bounds of objects
+    std::vector<Bounds> objectBounds; // by object index
+    bool rebuildBVH = true;
+};
+
+// bounds of box after transformation. may be larger than the tightest fit
+Bounds transformBounds(const Bounds &box, const glm::mat4 &transform);
+
+} // namespace
@@ -0,0 +1,109 @@
+#include "simplify.h"
+#include "operations.h"
+#include <algorithm>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include <glm/glm/geometric.hpp>
+
+namespace winged {
+
+static int valence(Vertex *vert) {
+    int count = 0;
+    for (ITER_VERTEX_EDGES(vert, vertEdge))
+        count++;
+    return count;
+}
+
+static bool isTriangle(HEdge *edge) {
+    return edge->next->next->next == edge;
+}
+
+static bool keepsValence(HEdge *edge) {
+    HEdge *twin = edge->twin;
+    // far corners of triangles lose an edge
+    if (isTriangle(edge) && valence(edge->prev->vert) <= 3)
+        return false;
+    if (isTriangle(twin) && valence(twin->prev->vert) <= 3)
+        return false;
+    int merged = valence(edge->vert) + valence(twin->vert) - 2
+        - isTriangle(edge) - isTriangle(twin);
+    return merged >= 3;
+}
+
+// move both ends to the midpoint, unless a remaining face would turn over
+static bool moveToMidpoint(HEdge *edge) {
+    Vertex *verts[2] = {edge->vert, edge->twin->vert};
+    glm::vec3 oldPos[2] = {verts[0]->pos, verts[1]->pos};
+    std::vector<std::pair<Face *, glm::vec3>> normals;
+    for (Vertex *vert : verts) {
+        for (ITER_VERTEX_EDGES(vert, vertEdge)) {
+            Face *face = vertEdge->face;
+            // triangles along the edge are removed
+            if ((face == edge->face && isTriangle(edge))
+                    || (face == edge->twin->face && isTriangle(edge->twin)))
+                continue;
+            normals.push_back({face, face->normalNonUnit()});
+        }
+    }
+    glm::vec3 mid = (oldPos[0] + oldPos[1]) / 2.0f;
+    verts[0]->pos = verts[1]->pos = mid;
+    for (auto &normal : normals) {
+        if (glm::dot(normal.first->normalNonUnit(), normal.second) <= 0) {
+            verts[0]->pos = oldPos[0];
+            verts[1]->pos = oldPos[1];
+            return false;
+        }
+    }
+    return true;
+}
+
+int simplifySurface(Surface *surface, float ratio) {
+    size_t startVerts = surface->vertices.size();
+    size_t target = (size_t)(std::max(ratio, 0.0f) * startVerts);
+    std::vector<std::pair<float, HEdge *>> queue;
+    // vertices near a collapse this pass. edges touching them may have been deleted
+    std::unordered_set<Vertex *> touched;
+
+    // each pass collapses an independent set of edges, shortest first
+    bool progress = true;
+    while (surface->vertices.size() > target && progress) {
+        progress = false;
+        queue.clear();
+        for (auto &edge : surface->edges) {
+            if (edge->primary() == edge.get()) {
+                glm::vec3 diff = edge->vert->pos - edge->twin->vert->pos;
+                queue.push_back({glm::dot(diff, diff), edge.get()});
+            }
+        }
+        std::sort(queue.begin(), queue.end(),
+            [](const std::pair<float, HEdge *> &a, const std::pair<float, HEdge *> &b) {
+                return a.first < b.first;
+            });
+        touched.clear();
+        // endpoints are saved before anything is deleted
+        std::vector<std::pair<Vertex *, Vertex *>> ends(queue.size());
+        for (size_t i = 0; i < queue.size(); i++)
+            ends[i] = {queue[i].second->vert, queue[i].second->twin->vert};
+
+        for (size_t i = 0; i < queue.size() && surface->vertices.size() > target; i++) {
+            if (touched.count(ends[i].first) || touched.count(ends[i].second))
+                continue;
+            HEdge *edge = queue[i].second;
+            if (!canMergeAlongEdge(edge) || !keepsValence(edge) || !moveToMidpoint(edge))
+                continue;
+            // everything deleted by the collapse is between these vertices
+            for (Vertex *vert : {edge->vert, edge->twin->vert}) {
+                for (ITER_VERTEX_EDGES(vert, vertEdge)) {
+                    for (ITER_FACE_EDGES(vertEdge->face, faceEdge))
+                        touched.insert(faceEdge->vert);
+                }
+            }
+            mergeVerticesAlongEdge(surface, edge);
+            progress = true;
+        }
+    }
+    return (int)(startVerts - surface->vertices.size());
+}
+
+} // namespace
@@ -0,0 +1,14 @@
+#pragma once
+#include <common.h>
+
+#include "surface.h"
+
+namespace winged {
+
+// reduce to about ratio * the current number of vertices by collapsing the shortest edges to
+// their midpoints. collapses which would make the surface non-manifold, leave a vertex with
+// fewer than three edges, or flip a face are skipped, so the target may not be reached.
+// returns the number of vertices removed
+int simplifySurface(Surface *surface, float ratio);
+
+} // namespace
@@ -0,0 +1,91 @@
+#include "smooth.h"
+#include "parallel.h"
+
+namespace winged {
+
+void smoothPositions(Adjacency *adj, const SmoothOptions &options,
+        const std::vector<char> &movable) {
+    size_t numVerts = adj->positions.size();
+    bool cotangent = options.weights == SmoothOptions::COTANGENT && !adj->vertWeights.empty();
+    // weights are fixed from the initial shape rather than recomputed every iteration
+
+    // double-buffered structure-of-arrays positions
+    std::vector<float> pos[2][3];
+    for (int c = 0; c < 3; c++) {
+        pos[0][c].resize(numVerts);
+        pos[1][c].resize(numVerts);
+    }
+    for (size_t i = 0; i < numVerts; i++) {
+        for (int c = 0; c < 3; c++)
+            pos[0][c][i] = adj->positions[i][c];
+    }
+
+    const int *offsets = adj->vertOffsets.data(), *neighbors = adj->vertNeighbors.data();
+    const float *weights = adj->vertWeights.data();
+    int src = 0;
+    int steps = options.taubin ? options.iterations * 2 : options.iterations;
+    for (int step = 0; step < steps; step++) {
+        float factor = (options.taubin && (step & 1)) ? options.mu : options.lambda;
+        const float *sx = pos[src][0].data(), *sy = pos[src][1].data(), *sz = pos[src][2].data();
+        float *dx = pos[!src][0].data(), *dy = pos[!src][1].data(), *dz = pos[!src][2].data();
+        parallelFor(numVerts, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                float x = sx[i], y = sy[i], z = sz[i];
+                if (movable.empty() || movable[i]) {
+                    // separate accumulators so the compiler can vectorize the gather loop
+                    float ax = 0, ay = 0, az = 0, total = 0;
+                    if (cotangent) {
+                        for (int n = offsets[i]; n < offsets[i + 1]; n++) {
+                            float w = weights[n];
+                            int j = neighbors[n];
+                            ax += w * sx[j];
+                            ay += w * sy[j];
+                            az += w * sz[j];
+                            total += w;
+                        }
+                    } else {
+                        for (int n = offsets[i]; n < offsets[i + 1]; n++) {
+                            int j = neighbors[n];
+                            ax += sx[j];
+                            ay += sy[j];
+                            az += sz[j];
+                        }
+                        total = (float)(offsets[i + 1] - offsets[i]);
+                    }
+                    if (total > 0) {
+                        x += factor * (ax / total - x);
+                        y += factor * (ay / total - y);
+                        z += factor * (az / total - z);
+                    }
+                }
+                dx[i] = x;
+                dy[i] = y;
+                dz[i] = z;
+            }
+        }, 1024);
+        src = !src;
+    }
+
+    for (size_t i = 0; i < numVerts; i++)
+        adj->positions[i] = {pos[src][0][i], pos[src][1][i], pos[src][2][i]};
+}
+
+void smoothSurface(Surface *surface, const SmoothOptions &options,
+        const std::unordered_set<Vertex *> &selection) {
+    Adjacency adj;
+    adj.build(*surface,
+        options.weights == SmoothOptions::COTANGENT ? Adjacency::WEIGHTS : 0);
+    std::vector<char> movable;
+    if (!selection.empty()) {
+        movable.resize(adj.numVertices());
+        for (int i = 0; i < adj.numVertices(); i++)
+            movable[i] = selection.count(adj.vertices[i]) != 0;
+    }
+    smoothPositions(&adj, options, movable);
+    parallelFor(adj.vertices.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            adj.vertices[i]->pos = adj.positions[i];
+    });
+}
+
+} // namespace
@@ -0,0 +1,31 @@
+#pragma once
+#include <common.h>
+
+#include "surface.h"
+#include "adjacency.h"
+#include <unordered_set>
+
+namespace winged {
+
+struct SmoothOptions {
+    enum Weights {
+        UNIFORM,
+        COTANGENT
+    };
+    Weights weights = UNIFORM;
+    int iterations = 10;
+    float lambda = 0.5f;
+    // Taubin's non-shrinking variant alternates lambda with a negative mu step
+    bool taubin = false;
+    float mu = -0.53f;
+};
+
+// Laplacian smoothing of vertex positions. if selection is not empty only selected vertices move
+void smoothSurface(Surface *surface, const SmoothOptions &options,
+    const std::unordered_set<Vertex *> &selection);
+// operates on positions of an existing snapshot (built with WEIGHTS for COTANGENT).
+// movable may be empty to move all vertices. does not write back to the surface
+void smoothPositions(Adjacency *adj, const SmoothOptions &options,
+    const std::vector<char> &movable);
+
+} // namespace
@@ -0,0 +1,166 @@
+#include "snapping.h"
+#include "polygon.h"
+#include <algorithm>
+#include <cmath>
+#include <glm/glm/geometric.hpp>
+
+namespace winged {
+
+static Bounds faceBounds(Face *face) {
+    Bounds bounds;
+    for (ITER_FACE_EDGES(face, faceEdge))
+        bounds.extend(faceEdge->vert->pos);
+    return bounds;
+}
+
+static bool touches(Face *face, const std::unordered_set<Vertex *> &vertices) {
+    for (ITER_FACE_EDGES(face, faceEdge)) {
+        if (vertices.count(faceEdge->vert))
+            return true;
+    }
+    return false;
+}
+
+bool SnapIndex::current(const Surface *surface) const {
+    return surface == this->surface && surface->nextId == nextId
+        && surface->vertices.size() == numVerts && surface->faces.size() == numFaces
+        && surface->edges.size() == numEdges;
+}
+
+void SnapIndex::prepare(Surface *surface) {
+    if (current(surface))
+        return;
+    clear();
+    this->surface = surface;
+    nextId = surface->nextId;
+    numVerts = surface->vertices.size();
+    numFaces = surface->faces.size();
+    numEdges = surface->edges.size();
+    vertBounds.resize(numVerts);
+    for (auto &vert : surface->vertices)
+        vertBounds[vert->index].extend(vert->pos);
+    vertBVH.build(vertBounds);
+    faceBounds.resize(numFaces);
+    for (auto &face : surface->faces)
+        faceBounds[face->index] = winged::faceBounds(face.get());
+    faceBVH.build(faceBounds);
+}
+
+void SnapIndex::update(const std::vector<Vertex *> &moved) {
+    if (!surface || !current(surface))
+        return;
+    std::vector<int> changedVerts, changedFaces;
+    for (Vertex *vert : moved) {
+        vertBounds[vert->index] = Bounds();
+        vertBounds[vert->index].extend(vert->pos);
+        changedVerts.push_back((int)vert->index);
+        for (ITER_VERTEX_EDGES(vert, vertEdge))
+            changedFaces.push_back((int)vertEdge->face->index);
+    }
+    std::sort(changedFaces.begin(), changedFaces.end());
+    changedFaces.erase(std::unique(changedFaces.begin(), changedFaces.end()),
+        changedFaces.end());
+    for (int f : changedFaces)
+        faceBounds[f] = winged::faceBounds(surface->faces[f].get());
+    vertBVH.refit(vertBounds, changedVerts);
+    faceBVH.refit(faceBounds, changedFaces);
+}
+
+void SnapIndex::clear() {
+    surface = nullptr;
+    vertBounds.clear();
+    faceBounds.clear();
+    vertBVH.clear();
+    faceBVH.clear();
+}
+
+Vertex * SnapIndex::nearestVertex(glm::vec3 point, float maxDist,
+        const std::unordered_set<Vertex *> &exclude) const {
+    float distSquared = maxDist * maxDist;
+    int found = vertBVH.nearest(point, &distSquared, [&](int i) {
+        Vertex *vert = surface->vertices[i].get();
+        if (exclude.count(vert))
+            return INFINITY;
+        glm::vec3 diff = vert->pos - point;
+        return glm::dot(diff, diff);
+    });
+    return found >= 0 ? surface->vertices[found].get() : nullptr;
+}
+
+bool SnapIndex::nearestPointOnSurface(glm::vec3 point, float maxDist,
+        const std::unordered_set<Vertex *> &exclude, glm::vec3 *result) const {
+    float distSquared = maxDist * maxDist;
+    glm::vec3 best;
+    int found = faceBVH.nearest(point, &distSquared, [&](int i) {
+        Face *face = surface->faces[i].get();
+        if (touches(face, exclude))
+            return INFINITY;
+        glm::vec3 closest = closestPointOnFace(face, point);
+        glm::vec3 diff = closest - point;
+        float dist = glm::dot(diff, diff);
+        if (dist < distSquared)
+            best = closest;
+        return dist;
+    });
+    if (found < 0)
+        return false;
+    *result = best;
+    return true;
+}
+
+glm::vec3 closestPointOnTriangle(glm::vec3 p, glm::vec3 a, glm::vec3 b, glm::vec3 c) {
+    // Real-Time Collision Detection, Ericson, 5.1.5
+    glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+    float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+    if (d1 <= 0 && d2 <= 0)
+        return a;
+    glm::vec3 bp = p - b;
+    float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+    if (d3 >= 0 && d4 <= d3)
+        return b;
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0 && d1 >= 0 && d3 <= 0)
+        return a + ab * (d1 / (d1 - d3));
+    glm::vec3 cp = p - c;
+    float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+    if (d6 >= 0 && d5 <= d6)
+        return c;
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0 && d2 >= 0 && d6 <= 0)
+        return a + ac * (d2 / (d2 - d6));
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+        return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+    float denom = 1 / (va + vb + vc);
+    return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+glm::vec3 closestPointOnFace(Face *face, glm::vec3 point) {
+    // the same triangles the face is drawn with, so concave faces work
+    thread_local std::vector<Vertex *> faceVerts;
+    thread_local std::vector<glm::dvec2> facePoints;
+    thread_local std::vector<int> faceTriangles;
+    faceVerts.clear();
+    for (ITER_FACE_EDGES(face, faceEdge))
+        faceVerts.push_back(faceEdge->vert);
+    if (faceVerts.size() == 3)
+        return closestPointOnTriangle(point, faceVerts[0]->pos, faceVerts[1]->pos,
+            faceVerts[2]->pos);
+    projectFace(face, &facePoints);
+    faceTriangles.clear();
+    triangulatePolygon(facePoints, &faceTriangles);
+    glm::vec3 best = faceVerts[0]->pos;
+    float bestDist = INFINITY;
+    for (size_t t = 0; t + 2 < faceTriangles.size(); t += 3) {
+        glm::vec3 closest = closestPointOnTriangle(point, faceVerts[faceTriangles[t]]->pos,
+            faceVerts[faceTriangles[t + 1]]->pos, faceVerts[faceTriangles[t + 2]]->pos);
+        float dist = glm::dot(point - closest, point - closest);
+        if (dist < bestDist) {
+            bestDist = dist;
+            best = closest;
+        }
+    }
+    return best;
+}
+
+} // namespace
@@ -0,0 +1,48 @@
+#pragma once
+#include <common.h>
+
+#include "surface.h"
+#include "bvh.h"
+#include <unordered_set>
+#include <vector>
+#include <glm/glm/vec3.hpp>
+
+namespace winged {
+
+// snap targets for dragging vertices, over the whole surface. built once, then kept up to date
+// as vertices move, until the topology changes. the dragged vertices are left out of queries
+// instead of the index, so it stays valid from one drag to the next
+class SnapIndex {
+public:
+    // rebuild if the topology changed since it was built, or it was cleared. O(n log n) if it
+    // does, otherwise O(1)
+    void prepare(Surface *surface);
+    // after vertices moved, refit the bounds of them and their faces. does nothing if the index
+    // needs to be rebuilt anyway. O(k log n) for k vertices
+    void update(const std::vector<Vertex *> &moved);
+    void clear();
+    bool empty() const { return vertBVH.empty() && faceBVH.empty(); }
+
+    // exclude: vertices which are being dragged. faces touching them are skipped too
+    Vertex * nearestVertex(glm::vec3 point, float maxDist,
+        const std::unordered_set<Vertex *> &exclude) const; // null if none in range
+    // closest point on any face, false if none in range
+    bool nearestPointOnSurface(glm::vec3 point, float maxDist,
+        const std::unordered_set<Vertex *> &exclude, glm::vec3 *result) const;
+
+private:
+    Surface *surface = nullptr;
+    // the topology the index was built for. every operation that changes it creates or removes
+    // elements
+    uint32_t nextId = 0;
+    size_t numVerts = 0, numFaces = 0, numEdges = 0;
+    std::vector<Bounds> vertBounds, faceBounds; // by element index
+    BVH vertBVH, faceBVH;
+
+    bool current(const Surface *surface) const;
+};
+
+glm::vec3 closestPointOnTriangle(glm::vec3 p, glm::vec3 a, glm::vec3 b, glm::vec3 c);
+glm::vec3 closestPointOnFace(Face *face, glm::vec3 point);
+
+} // namespace
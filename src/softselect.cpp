@@ -0,0 +1,92 @@
+#include "softselect.h"
+#include "memusage.h"
+#include <algorithm>
+#include <glm/glm/geometric.hpp>
+
+namespace winged {
+
+void SoftSelection::begin(const std::unordered_set<Vertex *> &seeds, float radius) {
+    clear();
+    falloffRadius = radius;
+    for (auto &seed : seeds) {
+        tentative[seed] = 0;
+        front.push({0, seed});
+    }
+    expand();
+}
+
+void SoftSelection::clear() {
+    settled.clear();
+    tentative.clear();
+    front = {};
+    cachedWeights.clear();
+    weightsValid = false;
+}
+
+void SoftSelection::setRadius(float radius) {
+    if (radius == falloffRadius)
+        return;
+    falloffRadius = radius;
+    weightsValid = false;
+    expand(); // does nothing if the front is already past the radius
+}
+
+void SoftSelection::expand() {
+    while (!front.empty() && front.top().dist <= falloffRadius) {
+        Entry entry = front.top();
+        front.pop();
+        auto found = tentative.find(entry.vertex);
+        if (found->second < 0 || entry.dist > found->second)
+            continue; // already settled or stale
+        found->second = -1; // mark settled
+        settled.push_back(entry);
+        for (ITER_VERTEX_EDGES(entry.vertex, vertEdge)) {
+            Vertex *other = vertEdge->twin->vert;
+            float dist = entry.dist + glm::distance(entry.vertex->pos, other->pos);
+            auto it = tentative.find(other);
+            if (it == tentative.end()) {
+                tentative[other] = dist;
+                front.push({dist, other});
+            } else if (it->second >= 0 && dist < it->second) {
+                it->second = dist;
+                front.push({dist, other});
+            }
+        }
+    }
+}
+
+const std::vector<SoftSelection::Weight> & SoftSelection::weights() {
+    if (!weightsValid) {
+        // settled is sorted by distance, so vertices in range are a prefix
+        auto end = std::upper_bound(settled.begin(), settled.end(), falloffRadius,
+            [](float radius, const Entry &entry) { return radius < entry.dist; });
+        cachedWeights.clear();
+        cachedWeights.reserve(end - settled.begin());
+        for (auto it = settled.begin(); it != end; it++) {
+            float weight = 1;
+            if (falloffRadius > 0) {
+                float t = 1 - it->dist / falloffRadius;
+                weight = t * t * (3 - 2 * t); // smoothstep
+            }
+            cachedWeights.push_back({it->vertex, weight});
+        }
+        weightsValid = true;
+    }
+    return cachedWeights;
+}
+
+void SoftSelection::apply(glm::vec3 delta) {
+    for (auto &weight : weights())
+        weight.vertex->pos += delta * weight.weight;
+}
+
+void SoftSelection::addMemoryUsage(MemoryUsage *usage) const {
+    addContainerMemory(L"soft settled", settled, usage);
+    addContainerMemory(L"soft tentative", tentative, usage);
+    // the priority queue's vector isn't accessible, assume it's full
+    usage->categories.push_back({L"soft front", front.size(), front.size() * sizeof(Entry),
+        0, 0});
+    addContainerMemory(L"soft weights", cachedWeights, usage);
+}
+
+} // namespace
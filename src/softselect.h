@@ -0,0 +1,51 @@
+#pragma once
+#include <common.h>
+
+#include "surface.h"
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <glm/glm/vec3.hpp>
+
+namespace winged {
+
+struct MemoryUsage;
+
+// proportional editing. distances are measured along surface edges from the seed vertices,
+// using a Dijkstra search that stops at the falloff radius and can be resumed if it grows.
+class SoftSelection {
+public:
+    struct Weight {
+        Vertex *vertex;
+        float weight;
+    };
+
+    void begin(const std::unordered_set<Vertex *> &seeds, float radius);
+    void clear();
+    void setRadius(float radius); // O(k) when shrinking, only visits new vertices when growing
+    float radius() const { return falloffRadius; }
+
+    const std::vector<Weight> & weights(); // cached until the radius changes
+    void apply(glm::vec3 delta); // move every vertex in range by weighted delta
+    void addMemoryUsage(MemoryUsage *usage) const;
+
+private:
+    struct Entry {
+        float dist;
+        Vertex *vertex;
+        bool operator>(const Entry &other) const { return dist > other.dist; }
+    };
+
+    float falloffRadius = 1;
+    // vertices with final distances, in nondecreasing order, possibly beyond the radius
+    std::vector<Entry> settled;
+    std::unordered_map<Vertex *, float> tentative;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> front;
+    std::vector<Weight> cachedWeights;
+    bool weightsValid = false;
+
+    void expand();
+};
+
+} // namespace
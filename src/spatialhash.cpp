@@ -0,0 +1,37 @@
+#include "spatialhash.h"
+#include "parallel.h"
+#include <algorithm>
+
+namespace winged {
+
+void SpatialHash::build(const std::vector<glm::vec3> &points, float cellSize) {
+    size_t count = points.size();
+    invCell = 1.0f / cellSize;
+    std::vector<std::pair<uint64_t, int>> cellPoints(count);
+    parallelFor(count, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            glm::ivec3 cell = glm::ivec3(glm::floor(points[i] * invCell));
+            cellPoints[i] = {cellKey(cell.x, cell.y, cell.z), (int)i};
+        }
+    });
+    std::sort(cellPoints.begin(), cellPoints.end());
+
+    size_t size = 16;
+    while (size < count * 2)
+        size *= 2;
+    keys.assign(size, EMPTY);
+    ranges.resize(size);
+    mask = size - 1;
+    sorted.resize(count);
+    for (size_t i = 0; i < count;) {
+        size_t end = i;
+        for (; end < count && cellPoints[end].first == cellPoints[i].first; end++)
+            sorted[end] = cellPoints[end].second;
+        size_t s = slot(cellPoints[i].first);
+        keys[s] = cellPoints[i].first;
+        ranges[s] = {(int)i, (int)end};
+        i = end;
+    }
+}
+
+} // namespace
@@ -0,0 +1,64 @@
+#pragma once
+#include <common.h>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <glm/glm/vec3.hpp>
+#include <glm/glm/common.hpp>
+
+namespace winged {
+
+// uniform grid over a fixed set of points, for finding neighbors within one cell size
+class SpatialHash {
+public:
+    void build(const std::vector<glm::vec3> &points, float cellSize); // O(n log n)
+    // point indices sorted by cell, visiting in this order keeps lookups in cache
+    const std::vector<int> & order() const { return sorted; }
+    // func(index) for every point in the 27 cells around pos. this includes points further
+    // than one cell size, callers check the distance themselves
+    template<typename Func>
+    void query(glm::vec3 pos, Func func) const;
+
+private:
+    static constexpr uint64_t EMPTY = ~(uint64_t)0;
+    float invCell = 1;
+    std::vector<int> sorted;
+    // open addressing table from cell key to a range of sorted. much faster to probe than
+    // std::unordered_map, which matters with 27 probes per query
+    std::vector<uint64_t> keys;
+    std::vector<std::pair<int, int>> ranges;
+    uint64_t mask = 0;
+
+    static uint64_t cellKey(int x, int y, int z) {
+        // 21 bits per axis, wraps around for huge coordinates (which only costs extra checks)
+        return ((uint64_t)(x & 0x1FFFFF) << 42) | ((uint64_t)(y & 0x1FFFFF) << 21)
+            | (uint64_t)(z & 0x1FFFFF);
+    }
+    size_t slot(uint64_t key) const {
+        size_t i = (key * 0x9E3779B97F4A7C15ull >> 20) & mask;
+        while (keys[i] != key && keys[i] != EMPTY)
+            i = (i + 1) & mask;
+        return i;
+    }
+};
+
+template<typename Func>
+void SpatialHash::query(glm::vec3 pos, Func func) const {
+    if (keys.empty())
+        return;
+    glm::ivec3 cell = glm::ivec3(glm::floor(pos * invCell));
+    for (int dx = -1; dx <= 1; dx++) {
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dz = -1; dz <= 1; dz++) {
+                size_t i = slot(cellKey(cell.x + dx, cell.y + dy, cell.z + dz));
+                if (keys[i] == EMPTY)
+                    continue;
+                for (int s = ranges[i].first; s < ranges[i].second; s++)
+                    func(sorted[s]);
+            }
+        }
+    }
+}
+
+} // namespace
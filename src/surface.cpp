@@ -21,24 +21,32 @@ glm::vec3 Face::normal() {
 }
 
 HEdge * HEdge::primary() {
-    return this < twin ? this : twin; // use pointer order
+    return id < twin->id ? this : twin;
+}
+
+template<typename T>
+T * addIndexed(std::vector<std::unique_ptr<T>> &vec, uint32_t *nextId) {
+    T *item = vec.emplace_back(new T).get();
+    item->id = (*nextId)++;
+    item->index = vec.size() - 1;
+    return item;
 }
 
 template<typename T>
 bool removeUnordered(std::vector<std::unique_ptr<T>> &vec, T *item) {
-    for (auto it = vec.begin(); it != vec.end(); it++) {
-        if (it->get() == item) {
-            *it = std::move(vec.back());
-            vec.pop_back();
-            return true;
-        }
+    size_t i = item->index;
+    if (i >= vec.size() || vec[i].get() != item) {
+        wprintf(L"Item could not be removed!\n");
+        return false;
     }
-    wprintf(L"Item could not be removed!\n");
-    return false;
+    vec[i] = std::move(vec.back());
+    vec[i]->index = i;
+    vec.pop_back();
+    return true;
 }
 
 Vertex * Surface::newVertex() {
-    return vertices.emplace_back(new Vertex).get();
+    return addIndexed(vertices, &nextId);
 }
 
 bool Surface::deleteVertex(Vertex *vertex) {
@@ -46,7 +54,7 @@ bool Surface::deleteVertex(Vertex *vertex) {
 }
 
 Face * Surface::newFace() {
-    return faces.emplace_back(new Face).get();
+    return addIndexed(faces, &nextId);
 }
 
 bool Surface::deleteFace(Face *face) {
@@ -54,7 +62,7 @@ bool Surface::deleteFace(Face *face) {
 }
 
 HEdge * Surface::newEdge() {
-    return edges.emplace_back(new HEdge).get();
+    return addIndexed(edges, &nextId);
 }
 
 bool Surface::deleteEdge(HEdge *edge) {
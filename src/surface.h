@@ -1,6 +1,7 @@
 #pragma once
 #include <common.h>
 
+#include <cstdint>
 #include <memory>
 #include <vector>
 #include <glm/glm/vec3.hpp>
@@ -16,12 +17,19 @@ struct Vertex {
     HEdge *edge; // any outgoing
 
     glm::vec3 pos;
+
+    // unique within the surface and never reused. unlike pointers, the same sequence of
+    // operations always assigns the same ids
+    uint32_t id;
+    size_t index; // position in Surface::vertices, maintained by Surface
 };
 
 // faces must be simple polygons, may be concave but may not contain holes
 // counter-clockwise orientation
 struct Face {
     HEdge *edge; // any
+    uint32_t id;
+    size_t index; // position in Surface::faces
 
     glm::vec3 normalNonUnit(); // O(n)
     glm::vec3 normal(); // slower than normalNonUnit() (computes a square root)
@@ -32,6 +40,8 @@ struct HEdge {
     HEdge *twin, *next, *prev;
     Vertex *vert; // "from" vertex
     Face *face;
+    uint32_t id;
+    size_t index; // position in Surface::edges
 
     HEdge * primary(); // O(1)
 };
@@ -47,9 +57,10 @@ struct Surface {
     std::vector<std::unique_ptr<Vertex>> vertices;
     std::vector<std::unique_ptr<Face>> faces;
     std::vector<std::unique_ptr<HEdge>> edges;
+    uint32_t nextId = 0;
 
     Vertex * newVertex(); // O(1)
-    bool deleteVertex(Vertex *vertex); // O(n)
+    bool deleteVertex(Vertex *vertex); // O(1), changes the order of vertices
     Face * newFace();
     bool deleteFace(Face *face);
     HEdge * newEdge();
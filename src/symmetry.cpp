@@ -0,0 +1,383 @@
+#include "symmetry.h"
+#include "operations.h"
+#include "parallel.h"
+#include "spatialhash.h"
+#include <algorithm>
+#include <cwchar>
+#include <glm/glm/geometric.hpp>
+
+namespace winged {
+
+static HEdge * findEdge(Vertex *from, Vertex *to) {
+    for (ITER_VERTEX_EDGES(from, vertEdge)) {
+        if (vertEdge->twin->vert == to)
+            return vertEdge;
+    }
+    return nullptr;
+}
+
+template<typename T>
+static T * lookup(const std::unordered_map<T *, T *> &map, T *key) {
+    auto found = map.find(key);
+    return found == map.end() ? nullptr : found->second;
+}
+
+bool Symmetry::build(Surface *surface) {
+    clear();
+    size_t numVerts = surface->vertices.size();
+    std::vector<glm::vec3> positions(numVerts);
+    for (size_t i = 0; i < numVerts; i++)
+        positions[i] = surface->vertices[i]->pos;
+    SpatialHash hash;
+    hash.build(positions, tolerance);
+
+    // count the vertices within tolerance of each reflected position. usually there's exactly
+    // one, but coincident vertices (eg. right after an extrude) need their neighbors to tell apart
+    std::vector<int> matches(numVerts), counts(numVerts);
+    float tolSquared = tolerance * tolerance;
+    parallelFor(numVerts, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            glm::vec3 target = reflect(positions[i]);
+            matches[i] = -1;
+            counts[i] = 0;
+            hash.query(target, [&](int j) {
+                glm::vec3 diff = positions[j] - target;
+                if (glm::dot(diff, diff) <= tolSquared) {
+                    counts[i]++;
+                    matches[i] = j;
+                }
+            });
+        }
+    });
+    auto noMirror = [&]() {
+        wprintf(L"Vertex has no mirror image!\n");
+        clear();
+        return false;
+    };
+    std::vector<int> ambiguous;
+    std::unordered_map<int, std::vector<int>> candidates;
+    for (size_t i = 0; i < numVerts; i++) {
+        if (counts[i] == 0)
+            return noMirror();
+        if (counts[i] > 1) {
+            ambiguous.push_back((int)i);
+            matches[i] = -1;
+            std::vector<int> &found = candidates[(int)i];
+            glm::vec3 target = reflect(positions[i]);
+            hash.query(target, [&](int j) {
+                glm::vec3 diff = positions[j] - target;
+                if (glm::dot(diff, diff) <= tolSquared)
+                    found.push_back(j);
+            });
+        }
+    }
+    // a unique match is also the mirror of its match, even if that one had other candidates
+    for (size_t i = 0; i < numVerts; i++) {
+        if (counts[i] == 1) {
+            int j = matches[i];
+            if (matches[j] == -1)
+                matches[j] = (int)i;
+            else if (matches[j] != (int)i)
+                return noMirror();
+        }
+    }
+
+    // a candidate fits if it's free, and next to the mirror of every matched neighbor
+    auto vert = [&](int i) { return surface->vertices[i].get(); };
+    auto fits = [&](int i, int j) {
+        if (matches[j] >= 0 && matches[j] != i)
+            return false;
+        for (ITER_VERTEX_EDGES(vert(i), vertEdge)) {
+            int neighborMirror = matches[vertEdge->twin->vert->index];
+            if (neighborMirror >= 0 && !findEdge(vert(j), vert(neighborMirror)))
+                return false;
+        }
+        return true;
+    };
+    std::vector<int> queue(ambiguous.rbegin(), ambiguous.rend());
+    auto assign = [&](int i, int j) {
+        matches[i] = j;
+        matches[j] = i;
+        for (int k : {i, j}) {
+            for (ITER_VERTEX_EDGES(vert(k), vertEdge)) {
+                if (matches[vertEdge->twin->vert->index] < 0)
+                    queue.push_back((int)vertEdge->twin->vert->index);
+            }
+        }
+    };
+    size_t nextGuess = 0;
+    while (true) {
+        while (!queue.empty()) {
+            int i = queue.back();
+            queue.pop_back();
+            if (matches[i] >= 0)
+                continue;
+            int fit = -1, numFits = 0;
+            for (int j : candidates[i]) {
+                if (fits(i, j)) {
+                    fit = j;
+                    numFits++;
+                }
+            }
+            if (numFits == 0)
+                return noMirror();
+            if (numFits == 1)
+                assign(i, fit);
+        }
+        // nothing left to go by (eg. a piece lying on top of its copy), any fit is as good
+        while (nextGuess < ambiguous.size() && matches[ambiguous[nextGuess]] >= 0)
+            nextGuess++;
+        if (nextGuess == ambiguous.size())
+            break;
+        int i = ambiguous[nextGuess];
+        auto &found = candidates[i];
+        auto fit = std::find_if(found.begin(), found.end(), [&](int j) { return fits(i, j); });
+        if (fit == found.end())
+            return noMirror();
+        assign(i, *fit);
+    }
+
+    vertMirrors.reserve(numVerts);
+    for (size_t i = 0; i < numVerts; i++) {
+        if (matches[i] < 0 || matches[matches[i]] != (int)i)
+            return noMirror();
+        vertMirrors[surface->vertices[i].get()] = surface->vertices[matches[i]].get();
+    }
+
+    edgeMirrors.reserve(surface->edges.size());
+    for (auto &edge : surface->edges) {
+        HEdge *mirrorEdge = findEdge(mirror(edge->twin->vert), mirror(edge->vert));
+        if (!mirrorEdge) {
+            wprintf(L"Edge has no mirror image!\n");
+            clear();
+            return false;
+        }
+        edgeMirrors[edge.get()] = mirrorEdge;
+    }
+    faceMirrors.reserve(surface->faces.size());
+    for (auto &face : surface->faces)
+        faceMirrors[face.get()] = mirror(face->edge)->face;
+    return true;
+}
+
+void Symmetry::clear() {
+    vertMirrors.clear();
+    edgeMirrors.clear();
+    faceMirrors.clear();
+}
+
+Vertex * Symmetry::mirror(Vertex *vertex) const {
+    return lookup(vertMirrors, vertex);
+}
+
+HEdge * Symmetry::mirror(HEdge *edge) const {
+    return lookup(edgeMirrors, edge);
+}
+
+Face * Symmetry::mirror(Face *face) const {
+    return lookup(faceMirrors, face);
+}
+
+void Symmetry::relinkAround(Vertex *vertex) {
+    Vertex *mirrorVert = mirror(vertex);
+    for (ITER_VERTEX_EDGES(vertex, vertEdge)) {
+        Vertex *mirrorOther = mirror(vertEdge->twin->vert);
+        HEdge *mirrorEdge = mirrorVert && mirrorOther ? findEdge(mirrorOther, mirrorVert) : nullptr;
+        if (!mirrorEdge) {
+            wprintf(L"Symmetry was broken!\n");
+            continue;
+        }
+        link(edgeMirrors, vertEdge, mirrorEdge);
+        link(edgeMirrors, vertEdge->twin, mirrorEdge->twin);
+        link(faceMirrors, vertEdge->face, mirrorEdge->face);
+        link(faceMirrors, vertEdge->twin->face, mirrorEdge->twin->face);
+    }
+}
+
+bool Symmetry::splitEdge(Surface *surface, HEdge *edge) {
+    HEdge *mirrorEdge = mirror(edge);
+    if (!mirrorEdge) {
+        wprintf(L"Edge has no mirror image!\n");
+        return false;
+    }
+    if (!winged::splitEdge(surface, edge))
+        return false;
+    Vertex *newVert = edge->next->vert;
+    if (mirrorEdge == edge || mirrorEdge == edge->twin) {
+        // edge crosses or lies on the plane
+        link(vertMirrors, newVert, newVert);
+    } else if (winged::splitEdge(surface, mirrorEdge)) {
+        link(vertMirrors, newVert, mirrorEdge->next->vert);
+    } else {
+        // can't happen, splitEdge always succeeds. the surface has changed either way
+        wprintf(L"Symmetry was broken!\n");
+        clear();
+        return true;
+    }
+    relinkAround(newVert);
+    return true;
+}
+
+// the same checks as winged::splitFace, without printing anything
+static bool canSplitFace(HEdge *e1, HEdge *e2) {
+    return e1 && e2 && e1->face == e2->face && e1->next != e2 && e2->next != e1;
+}
+
+static HEdge * findFaceEdge(Face *face, Vertex *vert) {
+    for (ITER_FACE_EDGES(face, faceEdge)) {
+        if (faceEdge->vert == vert)
+            return faceEdge;
+    }
+    return nullptr;
+}
+
+bool Symmetry::splitFace(Surface *surface, HEdge *e1, HEdge *e2) {
+    Vertex *a = e1->vert, *b = e2->vert;
+    Vertex *mirrorA = mirror(a), *mirrorB = mirror(b);
+    Face *face = e1->face, *mirrorFace = mirror(face);
+    if (!mirrorA || !mirrorB || !mirrorFace) {
+        wprintf(L"Face has no mirror image!\n");
+        return false;
+    }
+    if (!canSplitFace(e1, e2))
+        return winged::splitFace(surface, e1, e2); // prints why
+    // check the mirrored split before changing anything, so failing leaves the surface as it was
+    bool selfMirror = (mirrorA == a && mirrorB == b) || (mirrorA == b && mirrorB == a);
+    HEdge *m1 = nullptr, *m2 = nullptr;
+    bool sameFace = false; // the mirror edge splits one of the halves, only known after splitting
+    if (selfMirror) {
+        // the new edge is its own mirror image
+    } else if (mirrorFace != face) {
+        // edges in the mirror face starting at the mirror vertices
+        HEdge *mirror1 = mirror(e1), *mirror2 = mirror(e2);
+        m1 = mirror1 ? mirror1->next : nullptr;
+        m2 = mirror2 ? mirror2->next : nullptr;
+        if (!canSplitFace(m1, m2) || m1->face != mirrorFace) {
+            wprintf(L"Symmetry was broken!\n");
+            return false;
+        }
+    } else if (mirrorA == a || mirrorB == b) {
+        // the mirror edge goes from the vertex on the plane to the mirror of the other one.
+        // splitting keeps every edge of the face, so they can't be neighbors already
+        HEdge *planeEdge = mirrorA == a ? e1 : e2;
+        HEdge *otherMirror = findFaceEdge(face, mirrorA == a ? mirrorB : mirrorA);
+        if (!otherMirror || planeEdge->next == otherMirror || otherMirror->next == planeEdge) {
+            wprintf(L"Mirrored edge would be next to this edge!\n");
+            return false;
+        }
+        sameFace = true;
+    } else {
+        // the face crosses the plane, and so does the mirror edge. it has to stay on one side of
+        // this one, ie. both mirror vertices are on the same side of a going around the face
+        int index = 0, indexB = -1, indexMirrorA = -1, indexMirrorB = -1;
+        HEdge *faceEdge = e1;
+        do {
+            if (faceEdge->vert == b)
+                indexB = index;
+            if (faceEdge->vert == mirrorA)
+                indexMirrorA = index;
+            if (faceEdge->vert == mirrorB)
+                indexMirrorB = index;
+            index++;
+            faceEdge = faceEdge->next;
+        } while (faceEdge != e1);
+        if (indexMirrorA < 0 || indexMirrorB < 0) {
+            wprintf(L"Symmetry was broken!\n");
+            return false;
+        }
+        if ((indexMirrorA < indexB) != (indexMirrorB < indexB)) {
+            wprintf(L"Mirrored edge would cross this edge!\n");
+            return false;
+        }
+        sameFace = true;
+    }
+
+    if (!winged::splitFace(surface, e1, e2))
+        return false;
+    if (sameFace) {
+        // e1 and e2 are now in different halves
+        for (Face *half : {e1->face, e2->face}) {
+            m1 = findFaceEdge(half, mirrorA);
+            m2 = findFaceEdge(half, mirrorB);
+            if (m1 && m2)
+                break;
+        }
+    }
+    if ((m1 || m2) && !winged::splitFace(surface, m1, m2)) {
+        // can't happen after the checks above. remove the new edge to undo the first split
+        winged::deleteEdge(surface, e2->prev);
+        return false;
+    }
+    relinkAround(a);
+    relinkAround(b);
+    return true;
+}
+
+bool Symmetry::extrudeFace(Surface *surface, Face *face) {
+    Face *mirrorFace = mirror(face);
+    if (!mirrorFace) {
+        wprintf(L"Face has no mirror image!\n");
+        return false;
+    }
+    // every vertex needs its mirror in the mirror face to link the new ones up afterwards
+    std::unordered_set<Vertex *> mirrorBase;
+    for (ITER_FACE_EDGES(mirrorFace, faceEdge))
+        mirrorBase.insert(faceEdge->vert);
+    for (ITER_FACE_EDGES(face, faceEdge)) {
+        if (!mirrorBase.count(mirror(faceEdge->vert))) {
+            wprintf(L"Face has no mirror image!\n");
+            return false;
+        }
+    }
+
+    // base vertex -> extruded copy, separately for each face since vertices on the plane can be
+    // in both
+    std::unordered_map<Vertex *, Vertex *> topVerts, mirrorTopVerts;
+    auto extrude = [&](Face *extruded, std::unordered_map<Vertex *, Vertex *> &tops) {
+        std::vector<Vertex *> base;
+        for (ITER_FACE_EDGES(extruded, faceEdge))
+            base.push_back(faceEdge->vert);
+        if (!winged::extrudeFace(surface, extruded))
+            return false;
+        // top edges start at the same place in the loop as the base edges did
+        size_t i = 0;
+        for (ITER_FACE_EDGES(extruded, topEdge))
+            tops[base[i++]] = topEdge->vert;
+        return true;
+    };
+    if (!extrude(face, topVerts))
+        return false;
+    if (mirrorFace == face) {
+        mirrorTopVerts = topVerts;
+    } else if (!extrude(mirrorFace, mirrorTopVerts)) {
+        // can't happen, extrudeFace always succeeds. the surface has changed either way
+        wprintf(L"Symmetry was broken!\n");
+        clear();
+        return true;
+    }
+    for (auto &pair : topVerts)
+        link(vertMirrors, pair.second, lookup(mirrorTopVerts, mirror(pair.first)));
+    for (auto &pair : topVerts) {
+        relinkAround(pair.second);
+        relinkAround(mirrorTopVerts[mirror(pair.first)]);
+    }
+    return true;
+}
+
+void Symmetry::moveVertices(const std::vector<std::pair<Vertex *, glm::vec3>> &moves) {
+    std::unordered_set<Vertex *> moving;
+    for (auto &move : moves)
+        moving.insert(move.first);
+    for (auto &move : moves) {
+        glm::vec3 delta = move.second;
+        Vertex *mirrorVert = mirror(move.first);
+        if (mirrorVert == move.first) {
+            delta[axis] = 0; // stay on the plane
+        } else if (mirrorVert && !moving.count(mirrorVert)) {
+            mirrorVert->pos += reflect(delta);
+        }
+        move.first->pos += delta;
+    }
+}
+
+} // namespace
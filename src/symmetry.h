@@ -0,0 +1,58 @@
+#pragma once
+#include <common.h>
+
+#include "surface.h"
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include <glm/glm/vec3.hpp>
+
+namespace winged {
+
+// correspondence between elements and their reflections across the plane pos[axis] = 0.
+// elements on the plane can be their own mirror. reflection reverses orientation, so the mirror
+// of edge u->v is m(v)->m(u).
+// the mirrored operations below keep the table up to date by only looking at the elements they
+// touch; after any other change to the surface, call build() again
+class Symmetry {
+public:
+    int axis = 0;
+    float tolerance = 1e-4f;
+
+    // match every vertex with a spatial hash, then edges and faces by their vertices. O(n).
+    // coincident vertices are told apart by which mirrors their neighbors are connected to.
+    // returns false if the surface is not symmetric
+    bool build(Surface *surface);
+    void clear();
+
+    glm::vec3 reflect(glm::vec3 v) const {
+        v[axis] = -v[axis];
+        return v;
+    }
+    Vertex * mirror(Vertex *vertex) const; // null if not matched
+    HEdge * mirror(HEdge *edge) const;
+    Face * mirror(Face *face) const;
+
+    // perform the operation and its mirror image, false if either isn't possible
+    bool splitEdge(Surface *surface, HEdge *edge);
+    bool splitFace(Surface *surface, HEdge *e1, HEdge *e2);
+    bool extrudeFace(Surface *surface, Face *face);
+    // apply deltas, and reflected deltas to mirrors which don't already have their own
+    void moveVertices(const std::vector<std::pair<Vertex *, glm::vec3>> &moves);
+
+private:
+    std::unordered_map<Vertex *, Vertex *> vertMirrors;
+    std::unordered_map<HEdge *, HEdge *> edgeMirrors;
+    std::unordered_map<Face *, Face *> faceMirrors;
+
+    template<typename T>
+    static void link(std::unordered_map<T *, T *> &map, T *a, T *b) {
+        map[a] = b;
+        map[b] = a;
+    }
+    // find mirrors of edges around vertex, and their faces, from vertex mirrors. O(valence)
+    void relinkAround(Vertex *vertex);
+};
+
+} // namespace
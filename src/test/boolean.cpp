@@ -0,0 +1,125 @@
+// regression tests for booleanSurfaces, run by ctest. exits nonzero if anything fails
+
+#include "surface.h"
+#include "operations.h"
+#include "boolean.h"
+#include <cmath>
+#include <cstdio>
+#include <cwchar>
+#include <map>
+#include <tuple>
+#include <vector>
+
+using namespace winged;
+
+// box from lo to hi with every side split into n x n quads, facing out
+static bool makeBox(Surface *surface, glm::vec3 lo, glm::vec3 hi, int n) {
+    std::vector<glm::vec3> positions;
+    std::vector<int> faceSizes, faceVerts;
+    std::map<std::tuple<int, int, int>, int> indices;
+    auto vertex = [&](int grid[3]) {
+        auto key = std::make_tuple(grid[0], grid[1], grid[2]);
+        auto found = indices.find(key);
+        if (found != indices.end())
+            return found->second;
+        glm::vec3 t(grid[0], grid[1], grid[2]);
+        positions.push_back(lo + (hi - lo) * t / (float)n);
+        return indices[key] = (int)positions.size() - 1;
+    };
+    for (int axis = 0; axis < 3; axis++) {
+        int u = (axis + 1) % 3, v = (axis + 2) % 3;
+        for (int side = 0; side < 2; side++) {
+            for (int i = 0; i < n; i++) {
+                for (int j = 0; j < n; j++) {
+                    int corners[4][2] = {{i, j}, {i + 1, j}, {i + 1, j + 1}, {i, j + 1}};
+                    int quad[4];
+                    for (int k = 0; k < 4; k++) {
+                        int grid[3];
+                        grid[axis] = side * n;
+                        grid[u] = corners[k][0];
+                        grid[v] = corners[k][1];
+                        // the far side goes around the other way to face out
+                        quad[side ? k : 3 - k] = vertex(grid);
+                    }
+                    faceSizes.push_back(4);
+                    faceVerts.insert(faceVerts.end(), quad, quad + 4);
+                }
+            }
+        }
+    }
+    return buildSurface(surface, positions, faceSizes, faceVerts);
+}
+
+static double volume(const Surface &surface) {
+    double sum = 0;
+    for (auto &face : surface.faces) {
+        glm::dvec3 p0 = face->edge->vert->pos;
+        for (HEdge *edge = face->edge->next; edge->next != face->edge; edge = edge->next) {
+            glm::dvec3 p1 = edge->vert->pos, p2 = edge->next->vert->pos;
+            sum += glm::dot(p0, glm::cross(p1, p2)) / 6;
+        }
+    }
+    return sum;
+}
+
+static int failures = 0;
+
+static void check(const wchar_t *name, const Surface &a, const Surface &b, BooleanOp op,
+        double expectVolume) {
+    Surface result;
+    bool ok = booleanSurfaces(&result, a, b, op) && validateSurface(&result);
+    double resultVolume = ok ? volume(result) : 0;
+    if (!ok || std::abs(resultVolume - expectVolume) > 1e-6) {
+        fwprintf(stderr, L"FAIL %ls: volume %g, expected %g\n", name, resultVolume, expectVolume);
+        failures++;
+    }
+}
+
+// a face plane of one side goes through grid lines and vertices of the other, which are only
+// touched by it, never split
+static void testAlignedGrid() {
+    Surface a, b;
+    makeBox(&a, glm::vec3(0, 0, 0), glm::vec3(2, 2, 2), 2);
+    makeBox(&b, glm::vec3(1, -1, -1), glm::vec3(3, 3, 3), 1);
+    check(L"aligned union", a, b, BOOLEAN_UNION, 8 + 32 - 4);
+    check(L"aligned intersection", a, b, BOOLEAN_INTERSECTION, 4);
+    check(L"aligned difference", a, b, BOOLEAN_DIFFERENCE, 8 - 4);
+    check(L"aligned reverse difference", b, a, BOOLEAN_DIFFERENCE, 32 - 4);
+}
+
+// faces of both sides lie in the same planes, with grid lines of one along edges of the other
+static void testSharedPlanes() {
+    Surface a, b;
+    makeBox(&a, glm::vec3(0, 1, 1), glm::vec3(4, 2, 3), 1);
+    makeBox(&b, glm::vec3(0, 1, 1), glm::vec3(3, 2, 2), 4);
+    check(L"shared planes union", a, b, BOOLEAN_UNION, 8);
+    check(L"shared planes intersection", a, b, BOOLEAN_INTERSECTION, 3);
+    check(L"shared planes difference", a, b, BOOLEAN_DIFFERENCE, 5);
+}
+
+// every combination of grid-aligned boxes in a small range which overlap
+static void testGridPairs() {
+    for (int offset = 0; offset < 27; offset++) {
+        glm::vec3 lo(offset % 3 - 1, offset / 3 % 3 - 1, offset / 9 - 1);
+        for (int n = 1; n <= 4; n *= 2) {
+            Surface a, b;
+            makeBox(&a, glm::vec3(0), glm::vec3(2), 2);
+            makeBox(&b, lo, lo + glm::vec3(2, 3, 2), n);
+            double overlap = 1;
+            for (int i = 0; i < 3; i++)
+                overlap *= std::fmin(2.0f, lo[i] + (i == 1 ? 3 : 2)) - std::fmax(0.0f, lo[i]);
+            check(L"grid pair union", a, b, BOOLEAN_UNION, 8 + 12 - overlap);
+            check(L"grid pair intersection", a, b, BOOLEAN_INTERSECTION, overlap);
+            check(L"grid pair difference", a, b, BOOLEAN_DIFFERENCE, 8 - overlap);
+        }
+    }
+}
+
+int main() {
+    testAlignedGrid();
+    testSharedPlanes();
+    testGridPairs();
+    if (failures)
+        fwprintf(stderr, L"%d failed\n", failures);
+    return failures ? 1 : 0;
+}
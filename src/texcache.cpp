@@ -0,0 +1,84 @@
+#include "texcache.h"
+#include "memusage.h"
+#include <chrono>
+#include <filesystem>
+#include <system_error>
+
+namespace winged {
+
+template<typename Decode>
+std::shared_ptr<const Texture> TextureCache::find(const Key &key, Decode decode) {
+    std::promise<std::shared_ptr<const Texture>> promise;
+    std::unique_lock<std::mutex> lock(mutex);
+    auto found = textures.find(key);
+    if (found != textures.end()) {
+        Entry entry = found->second;
+        lock.unlock(); // don't block other textures while waiting for this one
+        return entry.get();
+    }
+    textures[key] = promise.get_future().share();
+    lock.unlock();
+
+    // decode without holding the lock, so different files load in parallel
+    Image image;
+    std::shared_ptr<Texture> texture;
+    if (decode(&image)) {
+        texture = std::make_shared<Texture>();
+        generateMips(std::move(image), key.second, &texture->levels);
+    }
+    promise.set_value(texture);
+    if (!texture) {
+        lock.lock();
+        textures.erase(key);
+    }
+    return texture;
+}
+
+std::shared_ptr<const Texture> TextureCache::load(const char *path, MipFilter filter) {
+    // different spellings of the same path share a texture
+    std::error_code error;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+    Key key(error ? std::string(path) : canonical.string(), filter);
+    return find(key, [&](Image *image) {
+        return loadImage(image, path);
+    });
+}
+
+std::shared_ptr<const Texture> TextureCache::load(const char *name, const uint8_t *data,
+        size_t size, MipFilter filter) {
+    return find(Key(name, filter), [&](Image *image) {
+        return loadImage(image, data, size);
+    });
+}
+
+void TextureCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    textures.clear();
+}
+
+size_t TextureCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return textures.size();
+}
+
+void TextureCache::addMemoryUsage(MemoryUsage *usage) const {
+    MemoryUsage::Category category = {L"textures", 0, 0, 0, 0};
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &pair : textures) {
+        if (pair.second.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            continue; // still decoding
+        const Texture *texture = pair.second.get().get();
+        if (!texture)
+            continue; // failed, about to be removed
+        category.count++;
+        for (auto &level : texture->levels) {
+            size_t capacity = level.pixels.capacity();
+            category.bytes += level.pixels.size();
+            category.slack += capacity - level.pixels.size();
+            category.overhead += capacity ? heapBlockSize(capacity) - capacity : 0;
+        }
+    }
+    usage->categories.push_back(category);
+}
+
+} // namespace
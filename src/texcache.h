@@ -0,0 +1,50 @@
+#pragma once
+#include <common.h>
+
+#include "image.h"
+#include "mipmap.h"
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace winged {
+
+struct MemoryUsage;
+
+struct Texture {
+    std::vector<Image> levels; // full mip chain, levels[0] is the original image
+};
+
+// decoded textures shared by everything using the same file, so an image is decoded and filtered
+// once no matter how many materials refer to it. safe to call from multiple threads: a second
+// request for a texture which is still loading waits for the first instead of decoding again
+class TextureCache {
+public:
+    // null if the file can't be loaded. failures aren't cached so a fixed file can be retried
+    std::shared_ptr<const Texture> load(const char *path, MipFilter filter = MIP_GAMMA);
+    // image data which doesn't come from a file (eg. a resource), cached under name
+    std::shared_ptr<const Texture> load(const char *name, const uint8_t *data, size_t size,
+        MipFilter filter = MIP_GAMMA);
+    // textures still in use stay alive until they are released
+    void clear();
+    size_t size() const;
+    // textures which finished loading, whether or not they're still in use
+    void addMemoryUsage(MemoryUsage *usage) const;
+
+private:
+    using Key = std::pair<std::string, MipFilter>;
+    using Entry = std::shared_future<std::shared_ptr<const Texture>>;
+    mutable std::mutex mutex;
+    std::map<Key, Entry> textures;
+
+    template<typename Decode>
+    std::shared_ptr<const Texture> find(const Key &key, Decode decode);
+};
+
+} // namespace
@@ -0,0 +1,116 @@
+#include "weld.h"
+#include "operations.h"
+#include "parallel.h"
+#include "spatialhash.h"
+#include <algorithm>
+#include <cwchar>
+#include <mutex>
+#include <unordered_map>
+#include <cstdint>
+#include <vector>
+#include <glm/glm/geometric.hpp>
+
+namespace winged {
+
+struct WeldVertex {
+    int cluster; // index of the representative
+    glm::vec3 sum; // positions of this and every vertex merged into it
+    int count;
+};
+
+int weldVertices(Surface *surface, float tolerance) {
+    size_t numVerts = surface->vertices.size();
+    if (numVerts < 2 || tolerance <= 0)
+        return 0;
+    float tolSquared = tolerance * tolerance;
+
+    std::vector<Vertex *> verts(numVerts);
+    std::vector<glm::vec3> positions(numVerts);
+    for (size_t i = 0; i < numVerts; i++) {
+        verts[i] = surface->vertices[i].get();
+        positions[i] = verts[i]->pos;
+    }
+    SpatialHash hash;
+    hash.build(positions, tolerance);
+
+    // vertices with anything close, visiting vertices in cell order
+    std::vector<uint8_t> close(numVerts, 0);
+    parallelFor(numVerts, [&](size_t begin, size_t end) {
+        for (size_t s = begin; s < end; s++) {
+            int i = hash.order()[s];
+            hash.query(positions[i], [&](int j) {
+                glm::vec3 diff = positions[i] - positions[j];
+                if (j != i && glm::dot(diff, diff) <= tolSquared)
+                    close[i] = 1;
+            });
+        }
+    });
+    std::vector<Vertex *> welded;
+    for (size_t i = 0; i < numVerts; i++) {
+        if (close[i])
+            welded.push_back(verts[i]);
+    }
+    if (welded.empty())
+        return 0;
+    // id order, so the result doesn't depend on where things are in memory
+    std::sort(welded.begin(), welded.end(), [](Vertex *a, Vertex *b) { return a->id < b->id; });
+
+    // each cluster is everything within tolerance of its first vertex, so clusters can't chain
+    // beyond that like they would with single linkage
+    std::unordered_map<Vertex *, WeldVertex> clusterOf; // erased once merged into another vertex
+    clusterOf.reserve(welded.size());
+    for (auto &vert : welded) {
+        if (clusterOf.count(vert))
+            continue;
+        int rep = (int)vert->index;
+        hash.query(positions[rep], [&](int j) {
+            glm::vec3 diff = positions[rep] - positions[j];
+            if (close[j] && glm::dot(diff, diff) <= tolSquared && !clusterOf.count(verts[j]))
+                clusterOf[verts[j]] = {rep, positions[j], 1};
+        });
+    }
+
+    int blocked = 0;
+    for (auto &vert : welded) {
+        auto found = clusterOf.find(vert);
+        if (found == clusterOf.end())
+            continue; // merged into another vertex
+        int cluster = found->second.cluster;
+        bool merged;
+        int blockedEdges;
+        do {
+            merged = false;
+            blockedEdges = 0;
+            for (ITER_VERTEX_EDGES(vert, vertEdge)) {
+                Vertex *other = vertEdge->twin->vert;
+                auto otherCluster = clusterOf.find(other);
+                if (otherCluster == clusterOf.end() || otherCluster->second.cluster != cluster)
+                    continue;
+                if (!canMergeAlongEdge(vertEdge)) {
+                    if (vertEdge->primary() == vertEdge) // don't count twice
+                        blockedEdges++;
+                    continue;
+                }
+                WeldVertex &kept = clusterOf[vert];
+                kept.sum += otherCluster->second.sum;
+                kept.count += otherCluster->second.count;
+                clusterOf.erase(otherCluster);
+                mergeVerticesAlongEdge(surface, vertEdge);
+                merged = true;
+                break; // edge loop was modified
+            }
+        } while (merged);
+        blocked += blockedEdges;
+    }
+    // only vertices that absorbed others move, to the centroid of what they absorbed
+    for (auto &survivor : clusterOf) {
+        if (survivor.second.count > 1)
+            survivor.first->pos = survivor.second.sum / (float)survivor.second.count;
+    }
+
+    if (blocked)
+        wprintf(L"%d edges not collapsed, would make surface non-manifold\n", blocked);
+    return (int)(numVerts - surface->vertices.size());
+}
+
+} // namespace
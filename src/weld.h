@@ -0,0 +1,16 @@
+#pragma once
+#include <common.h>
+
+#include "surface.h"
+
+namespace winged {
+
+// merge vertices closer than tolerance to each other. clusters are found with a spatial hash,
+// each within tolerance of its first vertex by id, then collapsed along the edges connecting
+// them (like mergeVerticesAlongEdge). merged vertices move to the centroid of what was merged.
+// returns the number of vertices removed.
+// coincident vertices with no edge between them are left alone, since every edge already has
+// a twin and there are no open boundaries to join.
+int weldVertices(Surface *surface, float tolerance);
+
+} // namespace